@@ -82,15 +82,12 @@ def createParameters():
     return allTrees
 
 
-def runSimulations(allTrees):
+def runSimulations():
     myEnv = os.environ.copy()
     # myEnv['LD_LIBRARY_PATH'] = gslLinkDir
-    for treeList in allTrees:
-        print('\n--- Varying element: ' + treeList[0][0].split(' = ')[0])
-        for tree in treeList:
-            filename = tree[0] + '.json'
-            print('\n--- build/swimmers-brownian-simulation ' + filename)
-            subprocess.run(['build/swimmers-brownian-simulation', filename], env=myEnv)
+    # all the variations are simulated by one process, which shares its threads between them
+    print('\n--- build/swimmers-brownian-simulation --sweep')
+    subprocess.run(['build/swimmers-brownian-simulation', '--sweep', './param/full_physics_parameters.json', './param/article_physics_parameters.json'], env=myEnv)
 
 
 def parseArguments():
@@ -112,7 +109,7 @@ def plotResults(allTrees):
     if simulationParameters['save_trajectory']:
         for treeList in allTrees:
             for tree in treeList:
-                subprocess.run(['./plotter.py', '-t', tree[0] + '_trajectory.csv'])
+                subprocess.run(['./plotter.py', '-t', tree[0] + '_trajectory.bin'])
 
     # if simulationParameters['compute_diffusion']:
     #     for treeList in allTrees:
@@ -151,7 +148,7 @@ if __name__ == '__main__':
     subprocess.run('ninja', cwd='build')
 
     print('\n--- Running simulation program:')
-    runSimulations(allTrees)
+    runSimulations()
 
     print('\n--- Running plotter script:')
     plotResults(allTrees)
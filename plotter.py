@@ -6,6 +6,9 @@ import math
 from scipy.optimize import curve_fit
 import glob
 import argparse
+import json
+import os
+import zlib
 
 
 # def my_distribution_func(x, alpha, gamma=1):
@@ -133,18 +136,68 @@ def plot_displacement_all(filenames):
     plt.savefig(filename, bbox_inches='tight')
 
 
+def read_trajectory(filename):
+    # returns the header of a trajectory file written by TrajectoryWriter and its chunks, as an
+    # array of records with one field per column; uncompressed files are memory mapped
+    with open(filename, 'rb') as f:
+        if f.read(8) != b'SWTRAJ1\n':
+            raise ValueError(filename + ' is not a trajectory file')
+        headerSize = int(np.frombuffer(f.read(8), dtype='<u8')[0])
+        header = json.loads(f.read(headerSize))
+        offset = 16 + headerSize
+    chunkSize = header['chunk_size']
+    fields = []
+    for column in header['columns']:
+        shape = (chunkSize,) if column['per'] == 'snapshot' else (chunkSize, header['n_cells'])
+        fields.append((column['name'], column['type'], shape))
+    size = sum(np.dtype(column[1]).itemsize * int(np.prod(column[2])) for column in fields)
+    if size % 8 > 0:
+        fields.append(('padding', 'V' + str(8 - size % 8)))
+    payload = np.dtype(fields)
+    if header['compression'] == 'none':
+        chunk = np.dtype([('n_snapshots', '<u8'), ('size', '<u8'), ('payload', payload)])
+        nChunks = (os.path.getsize(filename) - offset) // chunk.itemsize
+        chunks = np.memmap(filename, dtype=chunk, mode='r', offset=offset, shape=(nChunks,))
+        return header, chunks['payload'], int(chunks['n_snapshots'].sum())
+    data = []
+    nSnapshots = 0
+    with open(filename, 'rb') as f:
+        f.seek(offset)
+        while True:
+            head = f.read(16)
+            if len(head) < 16:
+                break
+            n, size = np.frombuffer(head, dtype='<u8')
+            data.append(zlib.decompress(f.read(int(size))))
+            nSnapshots += int(n)
+    return header, np.frombuffer(b''.join(data), dtype=payload), nSnapshots
+
+
+def trajectory_column(trajectory, name, cell=None):
+    # values of a column in time, for one cell if the column is per cell
+    header, chunks, nSnapshots = trajectory
+    column = chunks[name]
+    if cell is not None:
+        column = column[:, :, cell]
+    return column.reshape(-1)[:nSnapshots]
+
+
 def plot_trajectory(filename):
-    coord = np.loadtxt(filename, delimiter=',')
-    minx = min(coord[:, 1])
-    miny = min(coord[:, 2])
-    maxx = max(coord[:, 1])
-    maxy = max(coord[:, 2])
+    trajectory = read_trajectory(filename)
+    nCells = trajectory[0]['n_cells']
+    x = [trajectory_column(trajectory, 'x', cell) for cell in range(nCells)]
+    y = [trajectory_column(trajectory, 'y', cell) for cell in range(nCells)]
+    minx = min(min(coord) for coord in x)
+    miny = min(min(coord) for coord in y)
+    maxx = max(max(coord) for coord in x)
+    maxy = max(max(coord) for coord in y)
     size = max(maxx-minx,maxy-miny)
     fig = plt.figure(figsize=(8, 8), dpi=800, facecolor='w', edgecolor='k')
     ax = fig.add_subplot(111)
     ax.set_xlim(left=(maxx+minx-size)/2, right=(maxx+minx+size)/2)
     ax.set_ylim(bottom=(maxy+miny-size)/2, top=(maxy+miny+size)/2)
-    ax.add_line(Line2D(coord[:, 1], coord[:, 2], linewidth=0.1))
+    for cell in range(nCells):
+        ax.add_line(Line2D(x[cell], y[cell], linewidth=0.1, color=plt.cm.tab10(cell % 10)))
     # ax.scatter(coord[:, 1], coord[:, 2], [0.01]*len(coord[:, 0]))
     plt.savefig(filename[:-4] + '.png', bbox_inches='tight')
 
@@ -190,7 +243,7 @@ def main():
     parser.add_argument('-ra','--radialFileAll', nargs='+', default=[], help='plots all the radial probability in one figure')
     parser.add_argument('-d', '--displacementFile', action='store', default='', help='plots displacement probability file')
     parser.add_argument('-da', '--displacementFileAll', nargs='+', default=[], help='plots all the displacement probability files in one figure')
-    parser.add_argument('-t', '--trajectoryFile', action='store', default='', help='plots trajectory file')
+    parser.add_argument('-t', '--trajectoryFile', action='store', default='', help='plots the trajectories of a trajectory.bin file')
     parser.add_argument('-di', '--diffusionFile', action='store', default='', help='plots all the diffusion files')
     args = parser.parse_args()
 
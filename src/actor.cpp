@@ -1 +0,0 @@
-#include "actor.hpp"
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "analyzer.hpp"
+#include <algorithm>
 #include <sstream>
-#include <fstream>
-#include <gsl/gsl_integration.h>
 
-#include "cell.hpp"
+#include "csvBuffer.hpp"
+#include "population.hpp"
+#include "profiler.hpp"
 
 Analyzer::Analyzer(nlohmann::json simulation_parameters, nlohmann::json physics_parameters)
 {
@@ -14,8 +15,7 @@ Analyzer::Analyzer(nlohmann::json simulation_parameters, nlohmann::json physics_
     {
         this->map_width = simulation_parameters["probability_map_width"].get<int>();
         this->map_height = simulation_parameters["probability_map_height"].get<int>();
-        this->probability_map = std::vector<std::vector<double>>(map_width, std::vector<double>(map_height, 0));
-        this->n_map_points = 0;
+        this->end_slot = (simulation_parameters["n_time_steps"].get<int>() - simulation_parameters["saved_time_step_size"].get<int>()) / simulation_parameters["saved_time_step_size"].get<int>();
     }
     if (this->map_stats)
     {
@@ -36,6 +36,11 @@ Analyzer::Analyzer(nlohmann::json simulation_parameters, nlohmann::json physics_
         this->size_cell_x = (this->probability_map_right_corner_x - this->probability_map_left_corner_x) / map_width;
         this->size_cell_y = (this->probability_map_bottom_corner_y - this->probability_map_top_corner_y) / map_height;
     }
+    if (this->map_stats || this->end_map_stats)
+    {
+        this->probability_map.reset(new Histogram2D(this->map_width, this->map_height, this->probability_map_left_corner_x, this->probability_map_top_corner_y, this->probability_map_right_corner_x, this->probability_map_bottom_corner_y));
+        this->binary_map = simulation_parameters["binary_probability_map"].get<bool>();
+    }
 
     this->displacement_stats = simulation_parameters["compute_displacement"].get<bool>();
     if (this->displacement_stats)
@@ -55,81 +60,131 @@ Analyzer::Analyzer(nlohmann::json simulation_parameters, nlohmann::json physics_
         this->size_cell_y = (physics_parameters["wallBottom"]["y"].get<double>() - physics_parameters["wallTop"]["y"].get<double>()) / this->probability_map_height;
         this->gradient = std::vector<double>((this->memory_size) * (this->probability_map_height - 1), 0);
         this->flux = std::vector<double>((this->memory_size) * (this->probability_map_height - 1), 0);
+        this->prev_density_probability = std::vector<int>(this->probability_map_height, 0);
     }
 
-    this->save_trajectories = simulation_parameters["save_trajectory"].get<bool>();
     this->step_size = simulation_parameters["saved_time_step_size"].get<int>();
+    this->n_snapshots = 0;
+
+    this->correlation_stats = simulation_parameters["compute_correlation"].get<bool>();
+    if (this->correlation_stats)
+        this->correlator.reset(new MultiTauCorrelator(simulation_parameters["correlation_points_per_level"].get<int>(), simulation_parameters["n_saved_time_steps"].get<int>(), this->time_step_size * this->step_size));
 }
 
-void Analyzer::update_stats(Simulation *world, int start_time_step, int end_time_step, int step_size)
+// the end map only reads the last complete slot
+SnapshotDemand Analyzer::get_demand() const
 {
-    std::vector<Cell> cell = world->get_cells();
-    for (unsigned int i = 0; i < cell.size(); i++)
+    if (this->map_stats || this->displacement_stats || this->diffusion_stats || this->correlation_stats)
+        return SNAPSHOT_STREAM;
+    return this->end_map_stats ? SNAPSHOT_FINAL : SNAPSHOT_NONE;
+}
+
+void Analyzer::save_snapshot(const SnapshotView &snapshot)
+{
+    int slot = snapshot.slot;
+    this->n_snapshots++;
+    if (this->map_stats || (this->end_map_stats && slot == this->end_slot))
     {
-        if (this->map_stats)
-        {
-            for (int time = start_time_step; time < end_time_step; time += step_size)
-            {
-                Vector2D coord = cell[i].get_instance(time).coord;
-                if (coord[0] > this->probability_map_left_corner_x && coord[0] < this->probability_map_right_corner_x && coord[1] > this->probability_map_top_corner_y && coord[1] < this->probability_map_bottom_corner_y)
-                    this->probability_map[(int)((coord[0] - this->probability_map_left_corner_x) / size_cell_x)][(int)((coord[1] - this->probability_map_top_corner_y) / size_cell_y)]++;
-            }
-            this->n_map_points += (end_time_step - start_time_step) / step_size;
-        }
-        else if (this->end_map_stats)
+        this->map_x.resize(snapshot.size());
+        this->map_y.resize(snapshot.size());
+        for (int i = 0; i < snapshot.size(); i++)
         {
-            float time = end_time_step - step_size;
-            Vector2D coord = cell[i].get_instance(time).coord;
-            if (coord[0] > this->probability_map_left_corner_x && coord[0] < this->probability_map_right_corner_x && coord[1] > this->probability_map_top_corner_y && coord[1] < this->probability_map_bottom_corner_y)
-                this->probability_map[(int)((coord[0] - this->probability_map_left_corner_x) / size_cell_x)][(int)((coord[1] - this->probability_map_top_corner_y) / size_cell_y)]++;
-            this->n_map_points = 1;
+            this->map_x[i] = snapshot[i].coord[0];
+            this->map_y[i] = snapshot[i].coord[1];
         }
-        if (this->displacement_stats)
+        this->probability_map->add(this->map_x.data(), this->map_y.data(), snapshot.size());
+    }
+    if (this->displacement_stats && slot < (int)this->displacement.size())
+    {
+        for (const CellInstance &instance : snapshot)
+            this->displacement[slot] += instance.coord * instance.coord;
+        if (slot == 0)
+            this->n_tracks += snapshot.size();
+    }
+    if (this->diffusion_stats && slot < this->memory_size)
+    {
+        std::vector<int> density_probability = std::vector<int>(this->probability_map_height, 0);
+        for (const CellInstance &instance : snapshot)
+            density_probability[(int)((instance.coord[1] - this->probability_map_top_corner_y) / this->size_cell_y)] += 1;
+        if (slot > 0)
         {
-            for (int time = start_time_step; time < end_time_step; time += step_size)
+            for (int i = 1; i < this->probability_map_height; i++)
             {
-                Vector2D coord = cell[i].get_instance(time).coord;
-                this->displacement[time / step_size] += coord * coord;
+                this->gradient[(slot - 1) * (this->probability_map_height - 1) + i - 1] = density_probability[i] - density_probability[i - 1];
+                this->flux[(slot - 1) * (this->probability_map_height - 1) + i - 1] = density_probability[i] - this->prev_density_probability[i];
             }
-            this->n_tracks++;
-        }
-        if (this->save_trajectories)
-        {
-            std::stringstream strm;
-            strm << "output/" << i << "_trajectory.csv";
-            this->save_trajectory(strm.str().c_str(), &(cell[i]), start_time_step, end_time_step);
         }
+        this->prev_density_probability = density_probability;
+    }
+    if (this->correlation_stats)
+        this->correlator->push(snapshot);
+}
+
+void Analyzer::merge(const Analyzer &other)
+{
+    // an analyzer without snapshots would reset the diffusion profiles
+    if (other.n_snapshots == 0)
+        return;
+    this->n_snapshots += other.n_snapshots;
+    if (this->map_stats || this->end_map_stats)
+        this->probability_map->merge(*other.probability_map);
+    if (this->displacement_stats)
+    {
+        for (unsigned int i = 0; i < this->displacement.size(); i++)
+            this->displacement[i] += other.displacement[i];
+        this->n_tracks += other.n_tracks;
+    }
+    if (this->diffusion_stats) // the profiles of the last simulation are kept
+    {
+        this->gradient = other.gradient;
+        this->flux = other.flux;
+    }
+    if (this->correlation_stats)
+        this->correlator->merge(*other.correlator);
+}
+
+// accumulators only, the rest comes from the parameters
+void Analyzer::save_state(CheckpointWriter &out) const
+{
+    if (this->map_stats || this->end_map_stats)
+        this->probability_map->save_state(out);
+    if (this->displacement_stats)
+    {
+        out.write(this->displacement);
+        out.write(this->n_tracks);
     }
     if (this->diffusion_stats)
     {
-        std::vector<int> prev_density_probability = std::vector<int>(this->probability_map_height, 0);
-        std::vector<int> next_density_probability = std::vector<int>(this->probability_map_height, 0);
-        int int_time = 0;
-        for (int time = start_time_step; time < end_time_step; time += step_size)
-        {
-            prev_density_probability = next_density_probability;
-            std::fill(next_density_probability.begin(), next_density_probability.end(), 0);
-            for (unsigned int i = 0; i < cell.size(); i++)
-            {
-                double y = cell[i].get_instance(time).coord[1];
-                next_density_probability[(int)((y - this->probability_map_top_corner_y) / this->size_cell_y)] += 1;
-            }
-            if (int_time > 0)
-            {
-                for (int i = 1; i < this->probability_map_height; i++)
-                {
-                    this->gradient[(int_time - 1) * (this->probability_map_height - 1) + i - 1] = next_density_probability[i] - next_density_probability[i - 1];
-                    this->flux[(int_time - 1) * (this->probability_map_height - 1) + i - 1] = next_density_probability[i] - prev_density_probability[i];
-                }
-            }
-            int_time++;
-        }
-        printf("%d", 55);
+        out.write(this->gradient);
+        out.write(this->flux);
+        out.write(this->prev_density_probability);
+    }
+    if (this->correlation_stats)
+        this->correlator->save_state(out);
+}
+
+void Analyzer::load_state(CheckpointReader &in)
+{
+    if (this->map_stats || this->end_map_stats)
+        this->probability_map->load_state(in);
+    if (this->displacement_stats)
+    {
+        in.read(&this->displacement);
+        in.read(&this->n_tracks);
     }
+    if (this->diffusion_stats)
+    {
+        in.read(&this->gradient);
+        in.read(&this->flux);
+        in.read(&this->prev_density_probability);
+    }
+    if (this->correlation_stats)
+        this->correlator->load_state(in);
 }
 
 void Analyzer::compute_stats()
 {
+    PROFILE_SCOPE(PROFILE_STATS);
     if (this->map_stats)
     {
         this->compute_radial_probability(0., 0.);
@@ -164,7 +219,7 @@ void Analyzer::compute_radial_probability(double center_x, double center_y)
             double distance = sqrt((x * this->size_cell_x + this->probability_map_left_corner_x - center_x) * (x * this->size_cell_x + this->probability_map_left_corner_x - center_x) + (y * this->size_cell_y + this->probability_map_top_corner_y - center_y) * (y * this->size_cell_y + this->probability_map_top_corner_y - center_y));
             int index = (int)(distance / d_r);
             if (index < n_points)
-                local_p[index] += this->probability_map[x][y];
+                local_p[index] += this->probability_map->get_count(x, y);
         }
 
     for (int i = 0; i < n_points - n_local_points + 1; i++)
@@ -199,13 +254,13 @@ void Analyzer::save_stats(const std::string &file_name)
     if (this->end_map_stats)
     {
         std::stringstream strm;
-        strm << file_name << "_probability_map.csv";
+        strm << file_name << "_probability_map";
         this->save_probability_map(strm.str().c_str());
     }
     if (this->map_stats)
     {
         std::stringstream strm;
-        strm << file_name << "_probability_map.csv";
+        strm << file_name << "_probability_map";
         this->save_probability_map(strm.str().c_str());
         strm.str("");
         strm << file_name << "_radial_probability.csv";
@@ -226,55 +281,61 @@ void Analyzer::save_stats(const std::string &file_name)
         strm << file_name << "_diffusion.csv";
         this->save_diffusion(strm.str().c_str());
     }
+    if (this->correlation_stats)
+    {
+        std::stringstream strm;
+        strm << file_name << "_correlation.csv";
+        this->save_correlation(strm.str().c_str());
+    }
 }
 
+// the map of the whole run is a probability, the end map holds the counts of the cells
 void Analyzer::save_probability_map(const std::string &file_name)
 {
-    std::ofstream out(file_name);
-    for (auto &row : this->probability_map)
-    {
-        for (unsigned int i = 0; i < row.size(); i++) /// row.size()-1
-            out << row[i] / this->n_map_points << ",";
-        out << row[row.size()] / this->n_map_points;
-        out << "\n";
-    }
-    out.close();
+    double normalization = this->map_stats ? this->probability_map->get_n_points() : 1.;
+    this->probability_map->save_csv(file_name + ".csv", normalization);
+    if (this->binary_map)
+        this->probability_map->save_binary(file_name + ".bin");
 }
 
 void Analyzer::save_radial_probability(const std::string &file_name)
 {
-    std::ofstream out(file_name);
+    CsvBuffer out;
     for (unsigned int i = 0; i < this->radial_probability_r.size(); i++)
         out << this->radial_probability_r[i] << "," << this->radial_probability_p[i] << "\n";
-    out.close();
+    out.write(file_name);
 }
 
 void Analyzer::save_near_wall_probability(const std::string &file_name)
 {
-    std::ofstream out(file_name);
+    CsvBuffer out;
     out << this->wall_radius << "," << this->near_wall_probability;
-    out.close();
+    out.write(file_name);
 }
 
 void Analyzer::save_displacement(const std::string &file_name)
 {
-    std::ofstream out(file_name);
+    CsvBuffer out;
     for (unsigned int i = 0; i < this->displacement.size(); i++)
         out << this->time_step_size * (this->step_size * (i + 1) - 1) << "," << this->displacement[i] << "\n";
-    out.close();
-}
-
-void Analyzer::save_trajectory(const std::string &file_name, Cell *cell, int start_time_step, int end_time_step)
-{
-    std::ofstream out(file_name);
-    for (int i = start_time_step; i < end_time_step; i += this->step_size)
-        out << this->time_step_size * (i + this->step_size - 1) << "," << cell->get_instance(i).coord[0] << "," << cell->get_instance(i).coord[1] << "\n";
-    out.close();
+    out.write(file_name);
 }
 
 void Analyzer::save_diffusion(const std::string &file_name)
 {
-    std::ofstream out(file_name);
+    CsvBuffer out;
     for (int i = 500; i < (this->memory_size - 1) * (this->probability_map_height - 1); i++)
         out << this->gradient[i] << "," << this->flux[i] << "\n";
-}
\ No newline at end of file
+    out.write(file_name);
+}
+
+// lag time, mean squared displacement, velocity and orientation autocorrelations, for the
+// lags reached by the run
+void Analyzer::save_correlation(const std::string &file_name)
+{
+    CsvBuffer out;
+    for (int lag = 0; lag < this->correlator->get_n_lags(); lag++)
+        if (this->correlator->get_n_pairs(lag) > 0)
+            out << this->correlator->get_lag_time(lag) << "," << this->correlator->get_msd(lag) << "," << this->correlator->get_velocity(lag) << "," << this->correlator->get_orientation(lag) << "\n";
+    out.write(file_name);
+}
@@ -2,17 +2,25 @@
 #define ANALYZER_H
 
 #include "definition.hpp"
-#include "simulation.hpp"
+#include "snapshotSink.hpp"
+#include "checkpoint.hpp"
+#include "histogram2D.hpp"
+#include "multiTauCorrelator.hpp"
 #include <array>
+#include <memory>
 
-class Analyzer
+// Statistics of the saved states. Each simulation has its own Analyzer that receives its
+// snapshots, the analyzers are merged into one per point at the end.
+class Analyzer: public SnapshotSink
 {
     bool map_stats;
     bool displacement_stats;
-    bool save_trajectories;
     bool diffusion_stats;
     bool end_map_stats;
-    std::vector<std::vector<double>> probability_map;
+    bool correlation_stats;
+    bool binary_map;
+    std::unique_ptr<Histogram2D> probability_map;
+    std::vector<double> map_x, map_y; // coordinates of a snapshot, binned at once
     std::vector<double> radial_probability_p;
     std::vector<double> radial_probability_r;
     std::vector<double> displacement;
@@ -23,8 +31,9 @@ class Analyzer
     double probability_map_top_corner_y;
     double probability_map_right_corner_x;
     double probability_map_bottom_corner_y;
-    int n_map_points;
     int n_tracks;
+    int n_snapshots; // received, none if the thread ran no simulation
+    int end_slot;
     double size_cell_x;
     double size_cell_y;
     double near_wall_probability;
@@ -34,10 +43,16 @@ class Analyzer
     int probability_map_height;
     std::vector<double> gradient;
     std::vector<double> flux;
+    std::vector<int> prev_density_probability;
+    std::unique_ptr<MultiTauCorrelator> correlator;
 
   public:
     Analyzer(nlohmann::json simulation_parameters, nlohmann::json physics_parameters);
-    void update_stats(Simulation *world, int start_time_step, int end_time_step, int step_size);
+    SnapshotDemand get_demand() const override;
+    void save_snapshot(const SnapshotView &snapshot) override;
+    void merge(const Analyzer &other);
+    void save_state(CheckpointWriter &out) const;
+    void load_state(CheckpointReader &in);
     void compute_stats();
     void compute_radial_probability(double center_x, double center_y);
     void compute_near_wall_probability();
@@ -47,8 +62,8 @@ class Analyzer
     void save_radial_probability(const std::string &file_name);
     void save_near_wall_probability(const std::string &file_name);
     void save_displacement(const std::string &file_name);
-    void save_trajectory(const std::string &file_name, Cell *cell, int start_time_step, int end_time_step);
     void save_diffusion(const std::string &file_name);
+    void save_correlation(const std::string &file_name);
 };
 
 #endif
@@ -0,0 +1,71 @@
+#include "backgroundWriter.hpp"
+#include "profiler.hpp"
+#include <iostream>
+#include <string>
+
+BackgroundWriter::BackgroundWriter(int max_pending)
+{
+    this->max_pending = max_pending;
+    this->busy = false;
+    this->stop = false;
+    this->thread = std::thread(&BackgroundWriter::_work, this);
+}
+
+BackgroundWriter::~BackgroundWriter()
+{
+    this->wait();
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stop = true;
+    }
+    this->wake.notify_all();
+    this->thread.join();
+}
+
+void BackgroundWriter::submit(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->drained.wait(guard, [this] { return (int)this->task.size() < this->max_pending; });
+        this->task.push_back(std::move(task));
+    }
+    this->wake.notify_all();
+}
+
+void BackgroundWriter::wait()
+{
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->drained.wait(guard, [this] { return this->task.empty() && !this->busy; });
+}
+
+void BackgroundWriter::_work()
+{
+    while (true)
+    {
+        std::function<void()> next;
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->wake.wait(guard, [this] { return this->stop || !this->task.empty(); });
+            if (this->task.empty())
+                return;
+            next = std::move(this->task.front());
+            this->task.pop_front();
+            this->busy = true;
+        }
+        this->drained.notify_all();
+        try
+        {
+            PROFILE_SCOPE(PROFILE_OUTPUT);
+            next();
+        }
+        catch (std::string error)
+        {
+            std::cout << "ERROR: " << error << "\n";
+        }
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->busy = false;
+        }
+        this->drained.notify_all();
+    }
+}
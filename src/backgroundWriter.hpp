@@ -0,0 +1,37 @@
+#ifndef BACKGROUND_WRITER_H
+#define BACKGROUND_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs the output tasks (encoding and writing files) on a thread of its own, in the order
+// they are submitted, so the simulation threads do not wait for the disk. submit() only
+// blocks when max_pending tasks are already waiting, to bound the memory they hold.
+class BackgroundWriter
+{
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake, drained;
+    std::deque<std::function<void()>> task;
+    int max_pending;
+    bool busy;
+    bool stop;
+
+  public:
+    BackgroundWriter(int max_pending = 64);
+    ~BackgroundWriter();
+    BackgroundWriter(const BackgroundWriter &) = delete;
+    BackgroundWriter &operator=(const BackgroundWriter &) = delete;
+
+    void submit(std::function<void()> task);
+    // returns once every task submitted so far is done
+    void wait();
+
+  protected:
+    void _work();
+};
+
+#endif
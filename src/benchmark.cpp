@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "nlohmann/json.hpp"
+
+#include "runner.hpp"
+#include "simulation.hpp"
+
+// Times the phases of a simulation step (integration, map, pair forces, walls) and whole
+// steps on square grids of cells of several sizes and densities, with the cell parameters of
+// param/article_physics_parameters.json inside a disk wall. Prints the time per cell and per
+// step and writes all the results to a JSON file, to compare builds and commits.
+// usage: swimmers-benchmark [--output <json file>] [--threads <step threads>] [--min-time <seconds>]
+
+struct BenchmarkCase
+{
+    int side;          // cells per row of the grid
+    double separation; // between neighbour cells, micrometers; at 25 the flagella touch the next body
+};
+
+// mean time of one call in ns, calling the kernel until min_time seconds have passed
+static double time_kernel(const std::function<void()> &kernel, double min_time, long *n_calls)
+{
+    kernel(); // warm-up
+    long n = 1;
+    while (true)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (long i = 0; i < n; i++)
+            kernel();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= min_time)
+        {
+            *n_calls = n;
+            return elapsed * 1e9 / n;
+        }
+        n *= 2;
+    }
+}
+
+static nlohmann::json benchmark_simulation_parameters(int n_step_threads)
+{
+    nlohmann::json simulation_parameters;
+    simulation_parameters["visualization"] = false;
+    simulation_parameters["throw_errors"] = false;
+    simulation_parameters["time_step"] = 1e-4;
+    simulation_parameters["n_time_steps"] = 100000000;
+    simulation_parameters["n_saved_time_steps"] = 10000000;
+    simulation_parameters["saved_time_step_size"] = 10;
+    simulation_parameters["n_step_threads"] = n_step_threads;
+    simulation_parameters["adaptive_time_step"] = false;
+    simulation_parameters["max_time_step_size"] = 1;
+    simulation_parameters["step_tolerance"] = 0.5;
+    simulation_parameters["multi_rate"] = false;
+    simulation_parameters["multi_rate_skin"] = 2.0;
+    simulation_parameters["map_cell_size"] = 20.0;
+    return simulation_parameters;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string output_file = "output/benchmark.json";
+    int n_step_threads = 1;
+    double min_time = 0.2;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option(argv[i]);
+        if (option == "--output")
+            output_file = argv[i + 1];
+        else if (option == "--threads")
+            n_step_threads = std::stoi(argv[i + 1]);
+        else if (option == "--min-time")
+            min_time = std::stod(argv[i + 1]);
+        else
+        {
+            std::cout << "usage: " << argv[0] << " [--output <json file>] [--threads <step threads>] [--min-time <seconds>]\n";
+            return 1;
+        }
+    }
+
+    nlohmann::json reference;
+    {
+        std::ifstream input_file("./param/article_physics_parameters.json");
+        if (!input_file)
+        {
+            std::cout << "ERROR: Cannot open ./param/article_physics_parameters.json\n";
+            return 1;
+        }
+        input_file >> reference;
+    }
+    nlohmann::json simulation_parameters = benchmark_simulation_parameters(n_step_threads);
+    double delta_time_step = simulation_parameters["time_step"].get<double>();
+
+    nlohmann::json results = nlohmann::json::array();
+    std::cout << std::left << std::setw(14) << "kernel" << std::setw(8) << "cells" << std::setw(12) << "separation" << "ns/cell-step\n";
+    for (BenchmarkCase benchmark_case : {BenchmarkCase{10, 50.}, BenchmarkCase{10, 25.}, BenchmarkCase{32, 50.}, BenchmarkCase{32, 25.}, BenchmarkCase{100, 50.}, BenchmarkCase{100, 25.}})
+    {
+        // the grid inside a disk wall, with the cells of the border close to it
+        nlohmann::json physics_parameters = reference["parameters"];
+        double half_width = benchmark_case.separation * (benchmark_case.side - 1) / 2.;
+        physics_parameters["wallDisk"]["innerRadius"] = half_width * std::sqrt(2.) + 20.;
+        physics_parameters["wallDisk"]["thickness"] = 10.;
+        nlohmann::json grid;
+        grid["position"] = {{"x", 0.}, {"y", 0.}};
+        grid["separation"] = benchmark_case.separation;
+        grid["rows"] = benchmark_case.side;
+        grid["columns"] = benchmark_case.side;
+        grid["direction"] = 0.;
+        nlohmann::json initial_conditions = expand_initial_conditions({{"cell", {{{"grid", grid}}}}});
+
+        StepPool pool(n_step_threads);
+        Population population(physics_parameters["cell"], initial_conditions["cell"], simulation_parameters, CounterRng(5, 0));
+        int n_cells = population.size();
+        Map map(physics_parameters["wallTop"]["y"].get<double>(), physics_parameters["wallBottom"]["y"].get<double>(), physics_parameters["wallLeft"]["x"].get<double>(), physics_parameters["wallRight"]["x"].get<double>(), simulation_parameters["map_cell_size"].get<double>());
+        map.rebuild(population.get_x(), population.get_y(), n_cells, pool);
+        PairForce pair_force(population.get_parameters());
+        Boundary boundary(physics_parameters);
+        Simulation world(physics_parameters, initial_conditions, simulation_parameters, CounterRng(5, 0));
+
+        std::vector<CellForce> force(n_cells);
+        int n_errors = 0;
+        int now = 1;
+        std::vector<std::pair<std::string, std::function<void()>>> kernels;
+        kernels.push_back({"integration", [&]() {
+                               population.compute_step(now, delta_time_step, force, &n_errors, pool);
+                               population.update_state(now, pool);
+                               now++;
+                           }});
+        kernels.push_back({"map_rebuild", [&]() { map.rebuild(population.get_x(), population.get_y(), n_cells, pool); }});
+        kernels.push_back({"pair_forces", [&]() { pair_force.add_forces(population, map, force, pool); }});
+        kernels.push_back({"walls", [&]() { boundary.add_forces(population, force, pool); }});
+        kernels.push_back({"step", [&]() { world.compute_time_slice(1); }});
+
+        for (auto &kernel : kernels)
+        {
+            long n_calls;
+            double call_time = time_kernel(kernel.second, min_time, &n_calls);
+            // the forces only accumulate, they are reset between kernels
+            std::fill(force.begin(), force.end(), CellForce());
+            double cell_step_time = call_time / n_cells;
+            std::cout << std::left << std::setw(14) << kernel.first << std::setw(8) << n_cells << std::setw(12) << benchmark_case.separation << cell_step_time << "\n";
+            nlohmann::json result;
+            result["kernel"] = kernel.first;
+            result["n_cells"] = n_cells;
+            result["separation"] = benchmark_case.separation;
+            result["n_calls"] = n_calls;
+            result["ns_per_call"] = call_time;
+            result["ns_per_cell_step"] = cell_step_time;
+            results.push_back(result);
+        }
+    }
+
+    nlohmann::json report;
+    report["compiler"] = __VERSION__;
+    report["n_step_threads"] = n_step_threads;
+    report["min_time"] = min_time;
+    report["results"] = results;
+    std::filesystem::path path(output_file);
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path());
+    std::ofstream out(output_file);
+    out << report.dump(4) << "\n";
+    std::cout << "Results written to " << output_file << "\n";
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "boundary.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <limits>
+
+Boundary::Boundary(nlohmann::json physics_parameters)
+    : wallDisk(physics_parameters["wallDisk"]),
+      wallTop(physics_parameters["wallTop"]),
+      wallBottom(physics_parameters["wallBottom"]),
+      wallLeft(physics_parameters["wallLeft"]),
+      wallRight(physics_parameters["wallRight"])
+{
+    this->isWallDisk = physics_parameters["wallDisk"]["thickness"].get<double>() > 0;
+    this->isWallTop = physics_parameters["wallTop"]["thickness"].get<double>() > 0;
+    this->isWallBottom = physics_parameters["wallBottom"]["thickness"].get<double>() > 0;
+    this->isWallLeft = physics_parameters["wallLeft"]["thickness"].get<double>() > 0;
+    this->isWallRight = physics_parameters["wallRight"]["thickness"].get<double>() > 0;
+}
+
+bool Boundary::is_empty() const
+{
+    return !(this->isWallDisk || this->isWallTop || this->isWallBottom || this->isWallLeft || this->isWallRight);
+}
+
+double Boundary::get_reach(const CellParameters &p)
+{
+    return std::max(p.body_radius, p.body_flagella_distance + p.flagella_radius) * 1.122462; // 2^(1/6)
+}
+
+double Boundary::get_wall_distance(Vector2D coord) const
+{
+    double distance = std::numeric_limits<double>::infinity();
+    if (this->isWallDisk)
+        distance = std::min(distance, this->wallDisk.signed_distance(coord));
+    if (this->isWallTop)
+        distance = std::min(distance, this->wallTop.signed_distance(coord));
+    if (this->isWallBottom)
+        distance = std::min(distance, this->wallBottom.signed_distance(coord));
+    if (this->isWallLeft)
+        distance = std::min(distance, this->wallLeft.signed_distance(coord));
+    if (this->isWallRight)
+        distance = std::min(distance, this->wallRight.signed_distance(coord));
+    return distance;
+}
+
+void Boundary::add_forces(const Population &population, std::vector<CellForce> &force, StepPool &pool) const
+{
+    if (this->is_empty())
+        return;
+    PROFILE_SCOPE(PROFILE_WALLS);
+    const CellParameters &p = population.get_parameters();
+    double reach = Boundary::get_reach(p);
+    double disk_safe_radius = std::max(this->wallDisk.get_inner_radius() - reach, 0.);
+    const double *x = population.get_x();
+    const double *y = population.get_y();
+    const double *direction = population.get_direction();
+
+    pool.run_range(population.size(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            this->_add_cell_forces(p, reach, disk_safe_radius, Vector2D{x[i], y[i]}, direction[i], force[i]);
+    });
+}
+
+void Boundary::add_forces(const Population &population, const std::vector<int> &cells, std::vector<CellForce> &force) const
+{
+    if (this->is_empty())
+        return;
+    PROFILE_SCOPE(PROFILE_WALLS);
+    const CellParameters &p = population.get_parameters();
+    double reach = Boundary::get_reach(p);
+    double disk_safe_radius = std::max(this->wallDisk.get_inner_radius() - reach, 0.);
+    for (int i : cells)
+        this->_add_cell_forces(p, reach, disk_safe_radius, Vector2D{population.get_x()[i], population.get_y()[i]}, population.get_direction()[i], force[i]);
+}
+
+void Boundary::_add_cell_forces(const CellParameters &p, double reach, double disk_safe_radius, Vector2D body, double direction, CellForce &force) const
+{
+    // early out: the whole cell is beyond the cutoff of every wall
+    bool near_disk = this->isWallDisk && (body - this->wallDisk.get_coord()).square() >= disk_safe_radius * disk_safe_radius;
+    bool near_top = this->isWallTop && this->wallTop.signed_distance(body) < reach;
+    bool near_bottom = this->isWallBottom && this->wallBottom.signed_distance(body) < reach;
+    bool near_left = this->isWallLeft && this->wallLeft.signed_distance(body) < reach;
+    bool near_right = this->isWallRight && this->wallRight.signed_distance(body) < reach;
+    if (!(near_disk || near_top || near_bottom || near_left || near_right))
+        return;
+
+    Vector2D flagella = body + Vector2D{cos(direction), sin(direction)} * p.body_flagella_distance;
+    if (near_disk)
+        force += this->wallDisk.interaction(body, flagella, p.body_radius, p.flagella_radius);
+    if (near_top)
+        force += this->wallTop.interaction(body, flagella, p.body_radius, p.flagella_radius);
+    if (near_bottom)
+        force += this->wallBottom.interaction(body, flagella, p.body_radius, p.flagella_radius);
+    if (near_left)
+        force += this->wallLeft.interaction(body, flagella, p.body_radius, p.flagella_radius);
+    if (near_right)
+        force += this->wallRight.interaction(body, flagella, p.body_radius, p.flagella_radius);
+}
+
+void Boundary::draw(int time_step, Camera *camera) const
+{
+    if (this->isWallDisk)
+        this->wallDisk.draw(time_step, camera);
+    if (this->isWallTop)
+        this->wallTop.draw(time_step, camera);
+    if (this->isWallBottom)
+        this->wallBottom.draw(time_step, camera);
+    if (this->isWallLeft)
+        this->wallLeft.draw(time_step, camera);
+    if (this->isWallRight)
+        this->wallRight.draw(time_step, camera);
+}
@@ -0,0 +1,46 @@
+#ifndef BOUNDARY_H
+#define BOUNDARY_H
+
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "definition.hpp"
+#include "population.hpp"
+#include "stepPool.hpp"
+#include "wallDisk.hpp"
+#include "wallTop.hpp"
+#include "wallBottom.hpp"
+#include "wallLeft.hpp"
+#include "wallRight.hpp"
+
+// Walls of the simulation, handled analytically from the position of each cell
+// instead of through the neighbour grid. A wall is present if its thickness is positive.
+class Boundary
+{
+    bool isWallDisk;
+    bool isWallTop;
+    bool isWallBottom;
+    bool isWallLeft;
+    bool isWallRight;
+    WallDisk wallDisk;
+    WallTop wallTop;
+    WallBottom wallBottom;
+    WallLeft wallLeft;
+    WallRight wallRight;
+
+  public:
+    Boundary(nlohmann::json physics_parameters);
+    bool is_empty() const;
+    // farthest a point of a cell that feels a wall can be from the body center
+    static double get_reach(const CellParameters &p);
+    // distance of a point from the nearest wall, negative beyond it
+    double get_wall_distance(Vector2D coord) const;
+    void add_forces(const Population &population, std::vector<CellForce> &force, StepPool &pool) const;
+    // forces on the listed cells only
+    void add_forces(const Population &population, const std::vector<int> &cells, std::vector<CellForce> &force) const;
+    void draw(int time_step, Camera *camera) const;
+
+  protected:
+    void _add_cell_forces(const CellParameters &p, double reach, double disk_safe_radius, Vector2D body, double direction, CellForce &force) const;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "brownianBridge.hpp"
+#include <cmath>
+#include <string>
+
+BrownianBridge::BrownianBridge(CounterRng random_generator, int n_cells)
+{
+    this->random_generator = random_generator;
+    this->n_cells = n_cells;
+    this->n_intervals = 0;
+    this->spare = std::vector<double>(n_cells, 0.);
+}
+
+bool BrownianBridge::is_empty() const
+{
+    return this->n_intervals == 0;
+}
+
+BrownianBridge::Interval &BrownianBridge::_push()
+{
+    if ((int)this->interval.size() == this->n_intervals)
+        this->interval.push_back(Interval{0, 0, 0, std::vector<double>(this->n_cells, 0.), std::vector<double>(this->n_cells, 0.), std::vector<double>(this->n_cells, 0.)});
+    return this->interval[this->n_intervals++];
+}
+
+void BrownianBridge::start(int begin, int end, StepPool &pool)
+{
+    this->n_intervals = 0;
+    Interval &whole = this->_push();
+    whole.begin = begin;
+    whole.end = end;
+    whole.depth = 0;
+    // streams 5 and 6 of the first time step, the fixed steps use 0 to 4
+    double scale = std::sqrt((double)(end - begin));
+    pool.run_range(this->n_cells, [&](int first, int last) {
+        this->random_generator.fill_gaussian_pair(first, last, begin, 5, whole.x.data(), whole.y.data());
+        this->random_generator.fill_gaussian_pair(first, last, begin, 6, whole.torque.data(), this->spare.data());
+        for (int i = first; i < last; i++)
+        {
+            whole.x[i] *= scale;
+            whole.y[i] *= scale;
+            whole.torque[i] *= scale;
+        }
+    });
+}
+
+int BrownianBridge::get_begin() const
+{
+    return this->interval[this->n_intervals - 1].begin;
+}
+
+int BrownianBridge::get_size() const
+{
+    const Interval &next = this->interval[this->n_intervals - 1];
+    return next.end - next.begin;
+}
+
+void BrownianBridge::split(StepPool &pool)
+{
+    if (this->get_size() < 2)
+        throw std::string("Cannot split a step of one time step");
+    this->_push();
+    Interval &first = this->interval[this->n_intervals - 1];
+    Interval &whole = this->interval[this->n_intervals - 2]; // becomes the second half
+    int middle = whole.begin + (whole.end - whole.begin) / 2;
+    double n_whole = whole.end - whole.begin;
+    double n_first = middle - whole.begin;
+    double n_second = whole.end - middle;
+    // the first half given the whole increment: mean n_first / n_whole of it, variance n_first n_second / n_whole
+    double first_share = n_first / n_whole;
+    double bridge_std = std::sqrt(n_first * n_second / n_whole);
+    // two streams per depth, so that every interval has its own counters
+    uint32_t stream = 8 + 2 * whole.depth;
+    pool.run_range(this->n_cells, [&](int begin, int end) {
+        this->random_generator.fill_gaussian_pair(begin, end, whole.begin, stream, first.x.data(), first.y.data());
+        this->random_generator.fill_gaussian_pair(begin, end, whole.begin, stream + 1, first.torque.data(), this->spare.data());
+        for (int i = begin; i < end; i++)
+        {
+            first.x[i] = whole.x[i] * first_share + first.x[i] * bridge_std;
+            first.y[i] = whole.y[i] * first_share + first.y[i] * bridge_std;
+            first.torque[i] = whole.torque[i] * first_share + first.torque[i] * bridge_std;
+            whole.x[i] -= first.x[i];
+            whole.y[i] -= first.y[i];
+            whole.torque[i] -= first.torque[i];
+        }
+    });
+    first.begin = whole.begin;
+    first.end = middle;
+    first.depth = whole.depth + 1;
+    whole.begin = middle;
+    whole.depth++;
+}
+
+void BrownianBridge::pop()
+{
+    this->n_intervals--;
+}
+
+void BrownianBridge::get_noise(int begin, int end, double *noise_x, double *noise_y, double *noise_torque) const
+{
+    const Interval &next = this->interval[this->n_intervals - 1];
+    double scale = 1. / std::sqrt((double)(next.end - next.begin));
+    for (int i = begin; i < end; i++)
+    {
+        noise_x[i] = next.x[i] * scale;
+        noise_y[i] = next.y[i] * scale;
+        noise_torque[i] = next.torque[i] * scale;
+    }
+}
+
+void BrownianBridge::save_state(CheckpointWriter &out) const
+{
+    out.write(this->n_intervals);
+    for (int i = 0; i < this->n_intervals; i++)
+    {
+        const Interval &saved = this->interval[i];
+        out.write(saved.begin);
+        out.write(saved.end);
+        out.write(saved.depth);
+        for (const std::vector<double> *increment : {&saved.x, &saved.y, &saved.torque})
+            out.write(*increment);
+    }
+}
+
+void BrownianBridge::load_state(CheckpointReader &in)
+{
+    int n_intervals;
+    in.read(&n_intervals);
+    this->n_intervals = 0;
+    for (int i = 0; i < n_intervals; i++)
+    {
+        Interval &loaded = this->_push();
+        in.read(&loaded.begin);
+        in.read(&loaded.end);
+        in.read(&loaded.depth);
+        for (std::vector<double> *increment : {&loaded.x, &loaded.y, &loaded.torque})
+        {
+            in.read(increment);
+            if ((int)increment->size() != this->n_cells)
+                throw std::string("The checkpoint does not have the cells of the input file");
+        }
+    }
+}
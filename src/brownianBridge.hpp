@@ -0,0 +1,54 @@
+#ifndef BROWNIAN_BRIDGE_H
+#define BROWNIAN_BRIDGE_H
+
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "counterRng.hpp"
+#include "stepPool.hpp"
+
+// Noise of the adaptive time steps. The Brownian increments (x, y and rotation) of all the
+// cells over an interval of time steps are drawn at once, and an interval is split in two by
+// drawing the increment of its first half from the Brownian bridge between its ends. A
+// rejected step is then computed again as two halves with the same total noise, so the path
+// of the accepted steps is a path of the Brownian motion whatever the rejections were.
+// The intervals left to compute are kept on a stack, the next one on top. Increments are in
+// units of the noise of one time step: the increment of n time steps has variance n.
+class BrownianBridge
+{
+    struct Interval
+    {
+        int begin, end; // time steps [begin, end)
+        int depth;      // splits from the first interval, part of the random counters
+        std::vector<double> x, y, torque;
+    };
+
+    CounterRng random_generator;
+    int n_cells;
+    std::vector<Interval> interval; // the stack, entries are reused to keep their buffers
+    int n_intervals;
+    std::vector<double> spare;
+
+  public:
+    BrownianBridge(CounterRng random_generator, int n_cells);
+    bool is_empty() const;
+    // replaces the stack with the interval [begin, end)
+    void start(int begin, int end, StepPool &pool);
+    // first time step of the next interval
+    int get_begin() const;
+    // time steps in the next interval
+    int get_size() const;
+    // replaces the next interval with its two halves, the first one on top
+    void split(StepPool &pool);
+    // removes the next interval once its step is accepted
+    void pop();
+    // standard gaussians of the next interval for the cells [begin, end)
+    void get_noise(int begin, int end, double *noise_x, double *noise_y, double *noise_torque) const;
+    void save_state(CheckpointWriter &out) const;
+    void load_state(CheckpointReader &in);
+
+  protected:
+    Interval &_push();
+};
+
+#endif
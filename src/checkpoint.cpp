@@ -0,0 +1,38 @@
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+void CheckpointWriter::save(const std::string &file_name) const
+{
+    std::string temporary = file_name + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::string("Cannot open " + temporary);
+        out.write(this->data.data(), this->data.size());
+        if (!out)
+            throw std::string("Cannot write " + temporary);
+    }
+    if (std::rename(temporary.c_str(), file_name.c_str()) != 0)
+        throw std::string("Cannot replace " + file_name);
+}
+
+CheckpointReader::CheckpointReader(const std::string &file_name)
+{
+    this->file_name = file_name;
+    std::ifstream in(file_name, std::ios::binary);
+    if (!in)
+        throw std::string("Cannot open " + file_name);
+    this->data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    this->position = 0;
+}
+
+void CheckpointReader::_take(void *destination, size_t size)
+{
+    if (this->position + size > this->data.size())
+        throw std::string("The checkpoint " + this->file_name + " is truncated");
+    std::memcpy(destination, this->data.data() + this->position, size);
+    this->position += size;
+}
@@ -0,0 +1,64 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary state of a run, written between two time slices and read back by --resume.
+// Values are stored as their bytes in memory, so a checkpoint is meant to be read by the
+// same build on the same machine.
+class CheckpointWriter
+{
+    std::vector<char> data;
+
+  public:
+    template <typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as bytes");
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        this->data.insert(this->data.end(), bytes, bytes + sizeof(T));
+    }
+    template <typename T>
+    void write(const std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as bytes");
+        this->write((uint64_t)values.size());
+        const char *bytes = reinterpret_cast<const char *>(values.data());
+        this->data.insert(this->data.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+    // replaces the file through a temporary one, so an interrupted write leaves the previous checkpoint
+    void save(const std::string &file_name) const;
+};
+
+class CheckpointReader
+{
+    std::string file_name;
+    std::vector<char> data;
+    size_t position;
+
+  public:
+    CheckpointReader(const std::string &file_name);
+    template <typename T>
+    void read(T *value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as bytes");
+        this->_take(value, sizeof(T));
+    }
+    template <typename T>
+    void read(std::vector<T> *values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as bytes");
+        uint64_t size;
+        this->read(&size);
+        values->resize(size);
+        this->_take(values->data(), size * sizeof(T));
+    }
+
+  protected:
+    void _take(void *destination, size_t size);
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "counterRng.hpp"
+#include "vectorMath.hpp"
+
+inline void _philox(uint32_t &c_0, uint32_t &c_1, uint32_t &c_2, uint32_t &c_3, uint32_t key_0, uint32_t key_1)
+{
+#pragma GCC unroll 10
+    for (int round = 0; round < 10; round++)
+    {
+        uint64_t product_0 = (uint64_t)0xD2511F53u * c_0;
+        uint64_t product_1 = (uint64_t)0xCD9E8D57u * c_2;
+        uint32_t next_0 = (uint32_t)(product_1 >> 32) ^ c_1 ^ key_0;
+        uint32_t next_2 = (uint32_t)(product_0 >> 32) ^ c_3 ^ key_1;
+        c_1 = (uint32_t)product_1;
+        c_3 = (uint32_t)product_0;
+        c_0 = next_0;
+        c_2 = next_2;
+        key_0 += 0x9E3779B9u;
+        key_1 += 0xBB67AE85u;
+    }
+}
+
+// 53 random bits from two words, mapped to (0, 1]
+inline double _to_uniform(uint32_t high, uint32_t low)
+{
+    return ((int32_t)(high >> 5) * 67108864. + (int32_t)(low >> 6) + 1.) * (1. / 9007199254740992.);
+}
+
+inline void _box_muller(double u_1, double u_2, double *first, double *second)
+{
+    double radius = std::sqrt(-2. * fast_log(u_1));
+    double sin_angle, cos_angle;
+    fast_sincos(2. * M_PI * u_2, &sin_angle, &cos_angle);
+    *first = radius * cos_angle;
+    *second = radius * sin_angle;
+}
+
+CounterRng::CounterRng(uint32_t seed, uint32_t simulation)
+{
+    this->key[0] = seed;
+    this->key[1] = simulation;
+}
+
+void CounterRng::block(uint32_t cell, uint64_t step, uint32_t stream, uint32_t word[4]) const
+{
+    word[0] = stream;
+    word[1] = cell;
+    word[2] = (uint32_t)step;
+    word[3] = (uint32_t)(step >> 32);
+    _philox(word[0], word[1], word[2], word[3], this->key[0], this->key[1]);
+}
+
+void CounterRng::uniform_pair(uint32_t cell, uint64_t step, uint32_t stream, double *first, double *second) const
+{
+    uint32_t word[4];
+    this->block(cell, step, stream, word);
+    *first = _to_uniform(word[0], word[1]);
+    *second = _to_uniform(word[2], word[3]);
+}
+
+void CounterRng::gaussian_pair(uint32_t cell, uint64_t step, uint32_t stream, double *first, double *second) const
+{
+    double u_1, u_2;
+    this->uniform_pair(cell, step, stream, &u_1, &u_2);
+    _box_muller(u_1, u_2, first, second);
+}
+
+double CounterRng::exponential(uint32_t cell, uint64_t step, uint32_t stream, double mean) const
+{
+    double u_1, u_2;
+    this->uniform_pair(cell, step, stream, &u_1, &u_2);
+    return -mean * fast_log(u_1);
+}
+
+VECTOR_CLONES
+void CounterRng::fill_uniform_pair(int begin, int end, uint64_t step, uint32_t stream, double *first, double *second) const
+{
+    uint32_t key_0 = this->key[0], key_1 = this->key[1];
+#pragma omp simd
+    for (int i = begin; i < end; i++)
+    {
+        uint32_t c_0 = stream, c_1 = i, c_2 = (uint32_t)step, c_3 = (uint32_t)(step >> 32);
+        _philox(c_0, c_1, c_2, c_3, key_0, key_1);
+        first[i] = _to_uniform(c_0, c_1);
+        second[i] = _to_uniform(c_2, c_3);
+    }
+}
+
+VECTOR_CLONES
+void CounterRng::fill_gaussian_pair(int begin, int end, uint64_t step, uint32_t stream, double *first, double *second) const
+{
+    uint32_t key_0 = this->key[0], key_1 = this->key[1];
+#pragma omp simd
+    for (int i = begin; i < end; i++)
+    {
+        uint32_t c_0 = stream, c_1 = i, c_2 = (uint32_t)step, c_3 = (uint32_t)(step >> 32);
+        _philox(c_0, c_1, c_2, c_3, key_0, key_1);
+        _box_muller(_to_uniform(c_0, c_1), _to_uniform(c_2, c_3), &first[i], &second[i]);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+
+// Counter-based random number generator (Philox4x32-10).
+// The key is (seed, simulation index) and every draw is addressed by
+// (cell, time step, stream), so a number does not depend on the order in which
+// cells, steps or simulations are computed, nor on the thread computing them.
+class CounterRng
+{
+    uint32_t key[2];
+
+  public:
+    CounterRng(uint32_t seed = 0, uint32_t simulation = 0);
+
+    // four random words for the given counter
+    void block(uint32_t cell, uint64_t step, uint32_t stream, uint32_t word[4]) const;
+
+    // two independent uniforms in (0, 1]
+    void uniform_pair(uint32_t cell, uint64_t step, uint32_t stream, double *first, double *second) const;
+    // two independent standard gaussians
+    void gaussian_pair(uint32_t cell, uint64_t step, uint32_t stream, double *first, double *second) const;
+    double exponential(uint32_t cell, uint64_t step, uint32_t stream, double mean) const;
+
+    // batched versions over the cells [begin, end), written at the same indices
+    void fill_uniform_pair(int begin, int end, uint64_t step, uint32_t stream, double *first, double *second) const;
+    void fill_gaussian_pair(int begin, int end, uint64_t step, uint32_t stream, double *first, double *second) const;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "csvBuffer.hpp"
+#include <charconv>
+#include <fstream>
+
+CsvBuffer &CsvBuffer::operator<<(double value)
+{
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+    this->text.append(digits, result.ptr);
+    return *this;
+}
+
+CsvBuffer &CsvBuffer::operator<<(const char *text)
+{
+    this->text.append(text);
+    return *this;
+}
+
+void CsvBuffer::reserve(size_t size)
+{
+    this->text.reserve(size);
+}
+
+void CsvBuffer::write(const std::string &file_name) const
+{
+    std::ofstream out(file_name, std::ios::binary);
+    if (!out)
+        throw std::string("Cannot open " + file_name);
+    out.write(this->text.data(), this->text.size());
+}
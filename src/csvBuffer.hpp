@@ -0,0 +1,21 @@
+#ifndef CSV_BUFFER_H
+#define CSV_BUFFER_H
+
+#include <string>
+
+// Text of a whole output file, formatted in memory and written with a single call.
+// Numbers are written as an std::ostream does by default (6 significant digits, %g),
+// with std::to_chars instead of the stream machinery.
+class CsvBuffer
+{
+    std::string text;
+
+  public:
+    CsvBuffer &operator<<(double value);
+    CsvBuffer &operator<<(const char *text);
+    void reserve(size_t size);
+    // replaces the file
+    void write(const std::string &file_name) const;
+};
+
+#endif
@@ -97,6 +97,21 @@ struct CellForce
     }
 };
 
+// modulus of the repulsive Lennard-Jones force between a wall and a sphere at a signed
+// distance from it, zero beyond the 2^(1/6) cutoff
+inline double wall_force_modulus(double distance, double radius, double hardness)
+{
+    if (distance <= 0)
+        return 10000.;
+    if (distance >= radius * 1.122462) // 2^(1/6)
+        return 0.;
+    double rad_2 = radius * radius;
+    double rad_6 = rad_2 * rad_2 * rad_2;
+    double dist_2 = distance * distance;
+    double dist_6 = dist_2 * dist_2 * dist_2;
+    return 24 * hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
+}
+
 struct Camera
 {
     unsigned char pixels[SCREEN_HEIGHT][SCREEN_WIDTH][4];
@@ -0,0 +1,123 @@
+#include "histogram2D.hpp"
+#include <algorithm>
+#include <fstream>
+
+#include "nlohmann/json.hpp"
+#include "csvBuffer.hpp"
+
+Histogram2D::Histogram2D(int width, int height, double left, double top, double right, double bottom)
+{
+    this->width = width;
+    this->height = height;
+    this->left = left;
+    this->top = top;
+    this->right = right;
+    this->bottom = bottom;
+    this->bin_width = (right - left) / width;
+    this->bin_height = (bottom - top) / height;
+    this->count = std::vector<uint64_t>((size_t)width * height, 0);
+    this->n_points = 0;
+}
+
+void Histogram2D::add(const double *x, const double *y, int n)
+{
+    this->bin.resize(n);
+    int *bin = this->bin.data();
+    // local copies, the bins could alias the members
+    double left = this->left, top = this->top, right = this->right, bottom = this->bottom;
+    double bin_width = this->bin_width, bin_height = this->bin_height;
+    double last_x = this->width - 1., last_y = this->height - 1.;
+    int height = this->height;
+    // the bins are computed without branches and clamped, NaN included, before the conversion;
+    // the points rounding up to the far border go to the last bins
+#pragma omp simd
+    for (int i = 0; i < n; i++)
+    {
+        bool inside = (x[i] > left) & (x[i] < right) & (y[i] > top) & (y[i] < bottom);
+        int bin_x = (int)std::min(std::max(0., (x[i] - left) / bin_width), last_x);
+        int bin_y = (int)std::min(std::max(0., (y[i] - top) / bin_height), last_y);
+        bin[i] = inside ? bin_x * height + bin_y : -1;
+    }
+    uint64_t *count = this->count.data();
+    for (int i = 0; i < n; i++)
+        if (bin[i] >= 0)
+            count[bin[i]]++;
+    this->n_points += n;
+}
+
+void Histogram2D::merge(const Histogram2D &other)
+{
+    for (size_t i = 0; i < this->count.size(); i++)
+        this->count[i] += other.count[i];
+    this->n_points += other.n_points;
+}
+
+int Histogram2D::get_width() const
+{
+    return this->width;
+}
+
+int Histogram2D::get_height() const
+{
+    return this->height;
+}
+
+uint64_t Histogram2D::get_count(int x, int y) const
+{
+    return this->count[(size_t)x * this->height + y];
+}
+
+uint64_t Histogram2D::get_n_points() const
+{
+    return this->n_points;
+}
+
+void Histogram2D::save_csv(const std::string &file_name, double normalization) const
+{
+    CsvBuffer out;
+    out.reserve((size_t)this->width * this->height * 13);
+    for (int x = 0; x < this->width; x++)
+    {
+        const uint64_t *column = &this->count[(size_t)x * this->height];
+        for (int y = 0; y + 1 < this->height; y++)
+            out << column[y] / normalization << ",";
+        out << column[this->height - 1] / normalization;
+        out << "\n";
+    }
+    out.write(file_name);
+}
+
+void Histogram2D::save_binary(const std::string &file_name) const
+{
+    nlohmann::json header;
+    header["version"] = 1;
+    header["width"] = this->width;
+    header["height"] = this->height;
+    header["left"] = this->left;
+    header["top"] = this->top;
+    header["right"] = this->right;
+    header["bottom"] = this->bottom;
+    header["n_points"] = this->n_points;
+    header["type"] = "<u8";
+    std::string text = header.dump();
+    text.resize((text.size() + 7) / 8 * 8, ' ');
+    uint64_t header_size = text.size();
+
+    std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+    out.write("SWHIST1\n", 8);
+    out.write(reinterpret_cast<const char *>(&header_size), sizeof(header_size));
+    out.write(text.data(), text.size());
+    out.write(reinterpret_cast<const char *>(this->count.data()), this->count.size() * sizeof(uint64_t));
+}
+
+void Histogram2D::save_state(CheckpointWriter &out) const
+{
+    out.write(this->count);
+    out.write(this->n_points);
+}
+
+void Histogram2D::load_state(CheckpointReader &in)
+{
+    in.read(&this->count);
+    in.read(&this->n_points);
+}
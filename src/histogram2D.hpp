@@ -0,0 +1,43 @@
+#ifndef HISTOGRAM_2D_H
+#define HISTOGRAM_2D_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "checkpoint.hpp"
+
+// Counts of points in width x height bins covering the open rectangle (left, right) x
+// (top, bottom), stored contiguously with the bins of a column x consecutive. Every point
+// added is part of n_points, the ones outside the rectangle too, so the counts can be
+// normalized exactly. Each simulation fills its own histogram and the histograms of a point
+// are merged by adding the counts.
+class Histogram2D
+{
+    int width, height;
+    double left, top, right, bottom;
+    double bin_width, bin_height;
+    std::vector<uint64_t> count; // [x][y]
+    uint64_t n_points;
+
+    std::vector<int> bin; // scratch of add, -1 outside
+
+  public:
+    Histogram2D(int width, int height, double left, double top, double right, double bottom);
+    // bins n points at once, first their bins then the counts
+    void add(const double *x, const double *y, int n);
+    void merge(const Histogram2D &other);
+    int get_width() const;
+    int get_height() const;
+    uint64_t get_count(int x, int y) const;
+    uint64_t get_n_points() const;
+    // columns of the bins, each count divided by normalization
+    void save_csv(const std::string &file_name, double normalization) const;
+    // "SWHIST1\n", the uint64 size of a JSON header (bins, rectangle, n_points) padded with
+    // spaces to a multiple of 8, the header, then the uint64 counts as [width][height]
+    void save_binary(const std::string &file_name) const;
+    void save_state(CheckpointWriter &out) const;
+    void load_state(CheckpointReader &in);
+};
+
+#endif
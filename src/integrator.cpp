@@ -0,0 +1,83 @@
+#include "integrator.hpp"
+#include "vectorMath.hpp"
+
+template <bool off_center>
+VECTOR_CLONES int integrate_translation(int n, const StepConstants &constants, const double *x, const double *y, const double *direction, const CellForce *force,
+                          const double *noise_x, const double *noise_y, const double *noise_torque,
+                          double *next_x, double *next_y, double *rotation)
+{
+    const StepConstants c = constants;
+    int n_clamped = 0;
+#pragma omp simd reduction(+ : n_clamped)
+    for (int i = 0; i < n; i++)
+    {
+        double e_x, e_y;
+        fast_sincos(direction[i], &e_y, &e_x);
+
+        double force_x = (force[i].body[0] + force[i].flagella[0]) * c.mobility;
+        double force_y = (force[i].body[1] + force[i].flagella[1]) * c.mobility;
+        double force_2 = force_x * force_x + force_y * force_y;
+        bool clamp = force_2 > 9.;
+        double scale = clamp ? 3. / std::sqrt(force_2) : 1.;
+        n_clamped += clamp ? 1 : 0;
+
+        next_x[i] = x[i] + e_x * c.drift + force_x * scale + noise_x[i] * c.force_noise;
+        next_y[i] = y[i] + e_y * c.drift + force_y * scale + noise_y[i] * c.force_noise;
+
+        double torque_z = c.flagella_lever * (e_x * force[i].flagella[1] - e_y * force[i].flagella[0]);
+        if (off_center)
+            torque_z += c.body_lever * (e_x * force[i].body[1] - e_y * force[i].body[0]);
+        rotation[i] = torque_z * c.rotational_mobility + noise_torque[i] * c.torque_noise;
+    }
+    return n_clamped;
+}
+
+VECTOR_CLONES
+void integrate_free(int n, const StepConstants &constants, double drift_decay, const double *x, const double *y, const double *direction,
+                    const double *noise_x, const double *noise_y, const double *rotation, double *next_x, double *next_y)
+{
+    const StepConstants c = constants;
+#pragma omp simd
+    for (int i = 0; i < n; i++)
+    {
+        double half_rotation = 0.5 * rotation[i];
+        double e_x, e_y, sin_half, cos_half;
+        fast_sincos(direction[i] + half_rotation, &e_y, &e_x);
+        fast_sincos(half_rotation, &sin_half, &cos_half);
+        double sinc = std::abs(half_rotation) > 1e-8 ? sin_half / half_rotation : 1.;
+        double drift = c.drift * sinc * drift_decay;
+        next_x[i] = x[i] + e_x * drift + noise_x[i] * c.force_noise;
+        next_y[i] = y[i] + e_y * drift + noise_y[i] * c.force_noise;
+    }
+}
+
+template <bool off_center>
+VECTOR_CLONES void integrate_rotation(int n, double rotation_center, const double *direction, const double *rotation,
+                                      double *next_x, double *next_y, double *next_direction)
+{
+    if (off_center)
+    {
+#pragma omp simd
+        for (int i = 0; i < n; i++)
+        {
+            double e_x, e_y, sin_rotation, cos_rotation;
+            fast_sincos(direction[i], &e_y, &e_x);
+            fast_sincos(rotation[i], &sin_rotation, &cos_rotation);
+            // position of the cell center relative to the rotation center, before and after
+            double pos_x = -rotation_center * e_x;
+            double pos_y = -rotation_center * e_y;
+            next_x[i] += pos_x * cos_rotation - pos_y * sin_rotation - pos_x;
+            next_y[i] += pos_x * sin_rotation + pos_y * cos_rotation - pos_y;
+        }
+    }
+#pragma omp simd
+    for (int i = 0; i < n; i++)
+        next_direction[i] = direction[i] + rotation[i];
+}
+
+template int integrate_translation<false>(int, const StepConstants &, const double *, const double *, const double *, const CellForce *,
+                                          const double *, const double *, const double *, double *, double *, double *);
+template int integrate_translation<true>(int, const StepConstants &, const double *, const double *, const double *, const CellForce *,
+                                         const double *, const double *, const double *, double *, double *, double *);
+template void integrate_rotation<false>(int, double, const double *, const double *, double *, double *, double *);
+template void integrate_rotation<true>(int, double, const double *, const double *, double *, double *, double *);
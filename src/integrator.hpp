@@ -0,0 +1,44 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "definition.hpp"
+
+// constants of one Euler–Maruyama step, premultiplied by the time step
+struct StepConstants
+{
+    double drift;          // speed * dt
+    double mobility;       // diffusivity * dt
+    double force_noise;    // sqrt(2 D F dt)
+    double torque_noise;   // sqrt(2 T dt)
+    double body_lever;     // -rotation_center
+    double flagella_lever; // body_flagella_distance - rotation_center
+    double rotational_mobility; // dt / shear_time
+};
+
+// Batched kernels of the cell update. Each one is compiled for AVX-512, AVX2 and a
+// scalar fallback; the best version for the running CPU is picked by the loader.
+// The kernels taking off_center are specialized on a rotation center different from the
+// cell center: without it the force on the body has no torque and a rotation does not
+// move the center.
+
+// new position without the rotation-center correction and the deterministic plus
+// stochastic part of the rotation, returns the number of clamped forces
+template <bool off_center>
+int integrate_translation(int n, const StepConstants &constants, const double *x, const double *y, const double *direction, const CellForce *force,
+                          const double *noise_x, const double *noise_y, const double *noise_torque,
+                          double *next_x, double *next_y, double *rotation);
+
+// new position of cells that feel no force, over a step of any length: the drift follows the
+// mean direction of the cell along the step given its total rotation (noise and tumble), the
+// midpoint direction times sinc(rotation / 2), exact for a steady rotation, and
+// exp(-rotational_diffusion dt / 6) for the wandering of the rotational noise around it
+void integrate_free(int n, const StepConstants &constants, double drift_decay, const double *x, const double *y, const double *direction,
+                    const double *noise_x, const double *noise_y, const double *rotation, double *next_x, double *next_y);
+
+// applies the rotation to the direction and, if the cell rotates around a point
+// different from its center, the corresponding displacement
+template <bool off_center>
+void integrate_rotation(int n, double rotation_center, const double *direction, const double *rotation,
+                        double *next_x, double *next_y, double *next_direction);
+
+#endif
@@ -0,0 +1,159 @@
+#include "jobScheduler.hpp"
+#include <algorithm>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+JobScheduler::JobScheduler(int n_workers, int n_cpus_per_worker)
+{
+    this->n_workers = std::max(n_workers, 1);
+    this->n_cpus_per_worker = std::max(n_cpus_per_worker, 0);
+    // two jobs computed in turn on each worker, so a finished worker has started jobs to steal
+    this->n_live_jobs = 2;
+    for (int i = 0; i < this->n_workers; i++)
+        this->queue.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue));
+    this->n_queued = 0;
+    this->n_unfinished = 0;
+    this->run_slice = nullptr;
+}
+
+int JobScheduler::size() const
+{
+    return this->n_workers;
+}
+
+std::vector<int> JobScheduler::get_cpus(int worker) const
+{
+    std::vector<int> cpus;
+    int n_cpus = std::thread::hardware_concurrency();
+    if (this->n_cpus_per_worker == 0 || n_cpus == 0)
+        return cpus;
+    for (int i = 0; i < this->n_cpus_per_worker; i++)
+        cpus.push_back((worker * this->n_cpus_per_worker + i) % n_cpus);
+    return cpus;
+}
+
+void JobScheduler::run(int n_jobs, const std::function<bool(int, int)> &run_slice)
+{
+    if (n_jobs <= 0)
+        return;
+    // consecutive jobs on the same worker, the stealing evens out the differences of cost
+    for (int worker = 0; worker < this->n_workers; worker++)
+        for (int job = (long)n_jobs * worker / this->n_workers; job < (long)n_jobs * (worker + 1) / this->n_workers; job++)
+            this->queue[worker]->fresh.push_back(job);
+    this->n_queued = n_jobs;
+    this->n_unfinished = n_jobs;
+    this->run_slice = &run_slice;
+
+    std::vector<std::thread> threads;
+    for (int worker = 1; worker < this->n_workers; worker++)
+        threads.push_back(std::thread(&JobScheduler::_work, this, worker));
+    this->_work(0);
+    for (std::thread &thread : threads)
+        thread.join();
+    this->run_slice = nullptr;
+}
+
+void JobScheduler::_work(int worker)
+{
+    this->_pin(worker);
+    WorkerQueue &own = *this->queue[worker];
+    while (true)
+    {
+        int job;
+        if (!this->_take(worker, &job))
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->idle.wait(guard, [this] { return this->n_queued > 0 || this->n_unfinished == 0; });
+            if (this->n_unfinished == 0)
+                return;
+            continue;
+        }
+        bool done = (*this->run_slice)(job, worker);
+        if (done)
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->n_unfinished--;
+            if (this->n_unfinished == 0)
+                this->idle.notify_all();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> guard(own.lock);
+            own.started.push_back(job);
+        }
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->n_queued++;
+        }
+        this->idle.notify_one();
+    }
+}
+
+// next job of the worker: a new one while it has less than n_live_jobs started, else the
+// started ones in turn, else one stolen from another worker
+bool JobScheduler::_take(int worker, int *job)
+{
+    WorkerQueue &own = *this->queue[worker];
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.fresh.empty() && (int)own.started.size() < this->n_live_jobs)
+        {
+            *job = own.fresh.front();
+            own.fresh.pop_front();
+            found = true;
+        }
+        else if (!own.started.empty())
+        {
+            *job = own.started.front();
+            own.started.pop_front();
+            found = true;
+        }
+    }
+    if (!found)
+        found = this->_steal(worker, job);
+    if (found)
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->n_queued--;
+    }
+    return found;
+}
+
+// takes a started job from the back of another worker, or else a new job from the back
+bool JobScheduler::_steal(int worker, int *job)
+{
+    for (int pass = 0; pass < 2; pass++)
+        for (int i = 1; i < this->n_workers; i++)
+        {
+            WorkerQueue &victim = *this->queue[(worker + i) % this->n_workers];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            std::deque<int> &jobs = pass == 0 ? victim.started : victim.fresh;
+            if (!jobs.empty())
+            {
+                *job = jobs.back();
+                jobs.pop_back();
+                return true;
+            }
+        }
+    return false;
+}
+
+// binds the worker to its own n_cpus_per_worker cpus; the step threads of a job follow the
+// worker running its slice, see StepPool::pin
+void JobScheduler::_pin(int worker) const
+{
+#ifdef __linux__
+    std::vector<int> cpus = this->get_cpus(worker);
+    if (cpus.empty())
+        return;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs jobs [0, n_jobs) on n_workers threads (the calling thread is worker 0).
+// A job is computed as a sequence of slices: run_slice(job, worker) returns true when the
+// job is done, otherwise the job is put back in the queue of the worker. Each worker owns
+// a deque of jobs not started yet and a deque of started jobs; a worker with nothing left
+// steals from the other workers, started jobs first, so the last jobs are shared by all the
+// workers instead of being left to the thread that happened to start them. A job can
+// therefore run on another worker at each slice.
+class JobScheduler
+{
+    struct WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<int> fresh;   // jobs not started yet, taken from the front by the owner
+        std::deque<int> started; // jobs between two slices, computed in turn
+    };
+
+    int n_workers;
+    int n_cpus_per_worker; // 0 to leave the threads unpinned
+    int n_live_jobs;       // started jobs a worker keeps before starting another one
+    std::vector<std::unique_ptr<WorkerQueue>> queue;
+
+    std::mutex lock;
+    std::condition_variable idle;
+    int n_queued;    // jobs in the queues
+    int n_unfinished;
+
+    const std::function<bool(int, int)> *run_slice;
+
+  public:
+    JobScheduler(int n_workers, int n_cpus_per_worker);
+    int size() const;
+    // cpus the worker is bound to, empty when the threads are not pinned
+    std::vector<int> get_cpus(int worker) const;
+    void run(int n_jobs, const std::function<bool(int, int)> &run_slice);
+
+  protected:
+    void _work(int worker);
+    bool _take(int worker, int *job);
+    bool _steal(int worker, int *job);
+    void _pin(int worker) const;
+};
+
+#endif
@@ -1,21 +1,15 @@
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
-#include <thread>
-#include <mutex>
 #include <fstream>
-#include <sstream>
 #include <iostream>
-#include <thread>
 
 #include "nlohmann/json.hpp"
 
-#include "simulation.hpp"
-#include "analyzer.hpp"
-#include "visualization.hpp"
+#include "runner.hpp"
 
 nlohmann::json read_physics_parameters(std::string filename)
 {
     std::ifstream input_file(filename);
+    if (!input_file)
+        throw "Cannot open " + filename;
     nlohmann::json physics_parameters;
     input_file >> physics_parameters;
     input_file.close();
@@ -30,103 +24,99 @@ nlohmann::json read_simulation_parameters(std::string filename)
     input_file.close();
     simulation_parameters["n_time_steps"] = (int)(simulation_parameters["duration"].get<double>() / simulation_parameters["time_step"].get<double>());
     simulation_parameters["n_saved_time_steps"] = (int)(simulation_parameters["duration"].get<double>() / simulation_parameters["saved_time_step"].get<double>());
+    if (!simulation_parameters.contains("n_step_threads"))
+        simulation_parameters["n_step_threads"] = 1;
     simulation_parameters["saved_time_step_size"] = std::max(1, (int)(simulation_parameters["saved_time_step"].get<double>() / simulation_parameters["time_step"].get<double>()));
+    if (!simulation_parameters.contains("trajectory_compression"))
+        simulation_parameters["trajectory_compression"] = "none";
+    if (!simulation_parameters.contains("checkpoint_interval"))
+        simulation_parameters["checkpoint_interval"] = 0;
+    if (!simulation_parameters.contains("pin_threads"))
+        simulation_parameters["pin_threads"] = false;
+    // adaptive steps of up to max_time_step_size time steps, no cell moving more than step_tolerance micrometers
+    if (!simulation_parameters.contains("adaptive_time_step"))
+        simulation_parameters["adaptive_time_step"] = false;
+    if (!simulation_parameters.contains("max_time_step_size"))
+        simulation_parameters["max_time_step_size"] = simulation_parameters["saved_time_step_size"];
+    if (!simulation_parameters.contains("step_tolerance"))
+        simulation_parameters["step_tolerance"] = 0.5;
+    if (simulation_parameters["step_tolerance"].get<double>() > 3.)
+    {
+        // larger displacements are clamped as errors
+        std::cout << "WARNING: step_tolerance is reduced to 3 micrometers\n";
+        simulation_parameters["step_tolerance"] = 3.;
+    }
+    // single-cell replicates simulated together as the cells of one population
+    if (!simulation_parameters.contains("replicate_batch_size"))
+        simulation_parameters["replicate_batch_size"] = 1;
+    // multi-rate slots: cells that cannot meet a wall or another cell take one step per slot
+    if (!simulation_parameters.contains("multi_rate"))
+        simulation_parameters["multi_rate"] = false;
+    if (!simulation_parameters.contains("multi_rate_skin"))
+        simulation_parameters["multi_rate_skin"] = 2.0;
+    // probability maps also written as binary counts
+    if (!simulation_parameters.contains("binary_probability_map"))
+        simulation_parameters["binary_probability_map"] = false;
+    // time correlations of the saved states, with points_per_level lags per level of the multiple-tau correlator
+    if (!simulation_parameters.contains("compute_correlation"))
+        simulation_parameters["compute_correlation"] = false;
+    if (!simulation_parameters.contains("correlation_points_per_level"))
+        simulation_parameters["correlation_points_per_level"] = 16;
+    // a simulation is computed in slices of time_slice seconds, or at once if it is not positive
+    double time_slice = simulation_parameters.contains("time_slice") ? simulation_parameters["time_slice"].get<double>() : 0.;
+    if (time_slice > 0.)
+        simulation_parameters["time_slice_size"] = std::max(1, (int)(time_slice / simulation_parameters["time_step"].get<double>()));
+    else
+        simulation_parameters["time_slice_size"] = simulation_parameters["n_time_steps"];
     return simulation_parameters;
 }
 
-void thread_simulation(std::mutex *thread_lock, int *simulation_index, nlohmann::json physics_parameters, nlohmann::json simulation_parameters, Analyzer *analyzer, int thread_index, int *n_simulation_errors)
+int main(int argc, char *argv[])
 {
-    gsl_rng_env_setup();
-    gsl_rng *random_generator = gsl_rng_alloc(gsl_rng_default);
-    gsl_rng_set(random_generator, simulation_parameters["random_seed"].get<int>() + thread_index);
-    int n_thread_simulation_errors = 0;
-    bool simulate;
-    do
+    // continues the run interrupted with the same arguments, from output/checkpoint/
+    bool resume = argc > 1 && std::string(argv[1]) == "--resume";
+    int first = resume ? 2 : 1;
+    std::vector<RunPoint> point;
+    try
     {
-        simulate = false;
+        if (argc == first + 1)
         {
-            std::lock_guard<std::mutex> lock(*thread_lock);
-            if (*simulation_index < simulation_parameters["n_simulations"].get<int>())
-            {
-                (*simulation_index)++;
-                simulate = true;
-                std::cout << "\tSimulation n " << *simulation_index << " (thread " << thread_index << ")...\n";
-            }
+            // one input file, outputs named after it
+            std::string name(argv[first]);
+            point.push_back(RunPoint{name.substr(0, name.length() - 5), read_physics_parameters("./input/" + name), false});
         }
-        if (simulate)
+        else if (argc == first + 3 && std::string(argv[first]) == "--sweep")
+            // all the points of a sweep template in one run, see initializer.py
+            point = expand_sweep(read_physics_parameters(argv[first + 1]), read_physics_parameters(argv[first + 2]));
+        else
         {
-            Simulation world(physics_parameters["parameters"], physics_parameters["initialConditions"], simulation_parameters, random_generator);
-            try
-            {
-                n_thread_simulation_errors += world.compute_simulation();
-            }
-            catch (std::string error)
-            {
-                std::lock_guard<std::mutex> lock(*thread_lock);
-                std::cout << "ERROR: " << error << "\n";
-            }
-            {
-                std::lock_guard<std::mutex> lock(*thread_lock);
-                analyzer->update_stats(&world, 0, simulation_parameters["n_time_steps"].get<int>(), simulation_parameters["saved_time_step_size"].get<int>());
-                if (simulation_parameters["visualization"].get<bool>())
-                {
-                    std::cout << "\tVisualization...\n";
-#ifdef usesdl
-                    Visualization visualization;
-                    visualization.render(&world, 0, simulation_parameters["n_time_steps"].get<int>(), simulation_parameters["saved_time_step_size"].get<int>());
-#else
-                    std::cout << "ERROR: compiled without SDL2\n";
-#endif
-                }
-            }
+            std::cout << "ERROR: incorrect number of parameters\n";
+            std::cout << "usage: " << argv[0] << " [--resume] <input file>\n";
+            std::cout << "       " << argv[0] << " [--resume] --sweep <template parameters file> <reference parameters file>\n";
+            return 1;
         }
-    } while (simulate);
-    gsl_rng_free(random_generator);
-    {
-        std::lock_guard<std::mutex> lock(*thread_lock);
-        *n_simulation_errors += n_thread_simulation_errors;
     }
-}
-
-int main(int argc, char *argv[])
-{
-    if (argc != 2)
+    catch (std::string error)
     {
-        std::cout << "ERROR: incorrect number of parameters\n";
+        std::cout << "ERROR: " << error << "\n";
         return 1;
     }
-    std::stringstream strm;
-    strm << "./input/" << argv[1];
-    nlohmann::json physics_parameters = read_physics_parameters(strm.str().c_str());
     nlohmann::json simulation_parameters = read_simulation_parameters("./param/simulation_parameters.json");
 
     std::cout << "Computing simulations and probability map...\n";
-
-    Analyzer analyzer(simulation_parameters, physics_parameters["parameters"]);
-
-    int simulation_index = 0;
-    int n_simulation_errors = 0;
-    int n_threads = simulation_parameters["n_threads"].get<int>() - 1;
-    std::vector<std::thread> threads;
-    std::mutex thread_lock;
-
-    for (int thread_index = 0; thread_index < n_threads; ++thread_index)
-        threads.push_back(std::thread(thread_simulation, &thread_lock, &simulation_index, physics_parameters, simulation_parameters, &analyzer, thread_index, &n_simulation_errors));
-    thread_simulation(&thread_lock, &simulation_index, physics_parameters, simulation_parameters, &analyzer, n_threads, &n_simulation_errors);
-
-    for (int thread_index = 0; thread_index < n_threads; ++thread_index)
-        threads[thread_index].join();
-
-    std::cout << "Total number of simulation errors: " << n_simulation_errors << "\n";
-
-    std::cout << "Computing stats...\n";
-    analyzer.compute_stats();
-
-    std::cout << "Saving stats...\n";
-    strm.str("");
-    std::string temp(argv[1]);
-    strm << "output/" << temp.substr(0, temp.length() - 5);
-    analyzer.save_stats(strm.str().c_str());
+    Runner runner(simulation_parameters, point, resume);
+    int n_simulation_errors;
+    try
+    {
+        n_simulation_errors = runner.run();
+    }
+    catch (std::string error)
+    {
+        std::cout << "ERROR: " << error << "\n";
+        return 1;
+    }
+    if (point.size() > 1)
+        std::cout << "Total number of simulation errors: " << n_simulation_errors << "\n";
 
     return 0;
 }
@@ -1,4 +1,8 @@
 #include "map.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 
 Map::Map(double top, double bottom, double left, double right, double cell_size)
 {
@@ -6,81 +10,159 @@ Map::Map(double top, double bottom, double left, double right, double cell_size)
     this->cell_size = cell_size;
     this->top = top - cell_size*2;
     this->left = left - cell_size*2;
-    this->height = 5 + (int)((bottom - top) / cell_size);
-    this->width = 5 + (int)((right - left) / cell_size);
     if (this->isMapping)
-        this->cell = std::vector<std::set<Actor *>>(this->height * this->width);
+    {
+        this->height = 5 + (int)((bottom - top) / cell_size);
+        this->width = 5 + (int)((right - left) / cell_size);
+    }
     else
-        this->cell = std::vector<std::set<Actor *>>(0);
-}
-void Map::depart(Actor *actor, Vector2D coord)
-{
-    if (this->isMapping)
     {
-        int x = (int)((coord[0] - this->left) / cell_size);
-        int y = (int)((coord[1] - this->top) / cell_size);
-        cell[y * this->width + x].erase(actor);
+        this->height = 0;
+        this->width = 0;
     }
+    this->bucket_start = std::vector<int>(this->height * this->width + 1, 0);
+    this->window_begin = 0;
+    this->window_end = 0;
 }
-void Map::arrive(Actor *actor, Vector2D coord)
+
+bool Map::is_mapping() const
 {
-    if (this->isMapping)
-    {
-        int x = (int)((coord[0] - this->left) / cell_size);
-        int y = (int)((coord[1] - this->top) / cell_size);
-        cell[y * this->width + x].insert(actor);
-    }
+    return this->isMapping;
 }
-void Map::horizontal(Actor *actor, double yy)
+
+// bucket of a point, clamped so that the 3x3 neighbourhood is always inside the grid
+int Map::get_bucket(Vector2D coord) const
 {
-    if (this->isMapping)
-    {
-        int y = (int)((yy - this->top) / cell_size);
-        for (int x = 0; x < this->width; x++)
-            cell[y * this->width + x].insert(actor);
-    }
+    int x = std::min(std::max((int)((coord[0] - this->left) / cell_size), 1), this->width - 2);
+    int y = std::min(std::max((int)((coord[1] - this->top) / cell_size), 1), this->height - 2);
+    return y * this->width + x;
 }
-void Map::vertical(Actor *actor, double xx)
+
+void Map::rebuild(const double *x, const double *y, int n_cells, StepPool &pool)
 {
-    if (this->isMapping)
+    if (!this->isMapping)
+        return;
+    PROFILE_SCOPE(PROFILE_MAP_REBUILD);
+
+    this->cell_bucket.resize(n_cells);
+    this->sorted_cell.resize(n_cells);
+    if (n_cells == 0)
     {
-        int x = (int)((xx - this->left) / cell_size);
-        for (int y = 0; y < this->height; y++)
-            cell[y * this->width + x].insert(actor);
+        // no occupied bucket: an empty window, every range of cells is empty
+        this->window_begin = 0;
+        this->window_end = 0;
+        this->bucket_start[0] = 0;
+        return;
     }
+    int n_chunks = pool.size();
+    std::vector<int> chunk_first(n_chunks, this->height * this->width), chunk_last(n_chunks, 0);
+    pool.run(n_chunks, [&](int chunk) {
+        for (int i = (long)n_cells * chunk / n_chunks; i < (long)n_cells * (chunk + 1) / n_chunks; i++)
+        {
+            this->cell_bucket[i] = this->get_bucket(Vector2D{x[i], y[i]});
+            chunk_first[chunk] = std::min(chunk_first[chunk], this->cell_bucket[i]);
+            chunk_last[chunk] = std::max(chunk_last[chunk], this->cell_bucket[i]);
+        }
+    });
+    int first_bucket = *std::min_element(chunk_first.begin(), chunk_first.end());
+    int last_bucket = *std::max_element(chunk_last.begin(), chunk_last.end());
+    // only the buckets that can be reached from an occupied one are made valid, so the
+    // cost does not depend on the size of mostly empty grids
+    this->window_begin = std::max(first_bucket - this->width - 1, 0);
+    this->window_end = std::min(last_bucket + this->width + 2, this->height * this->width);
+    std::fill(this->bucket_start.begin() + this->window_begin, this->bucket_start.begin() + this->window_end + 1, 0);
+
+    // counting sort of the cells by bucket: count, inclusive prefix sum (end of each
+    // bucket), then scatter backwards so that each offset ends at the start of its bucket.
+    // It is linear in the number of cells and kept serial.
+    for (int i = 0; i < n_cells; i++)
+        this->bucket_start[this->cell_bucket[i]]++;
+    for (int b = this->window_begin + 1; b <= this->window_end; b++)
+        this->bucket_start[b] += this->bucket_start[b - 1];
+    for (int i = n_cells - 1; i >= 0; i--)
+        this->sorted_cell[--this->bucket_start[this->cell_bucket[i]]] = i;
 }
 
-std::set<Actor *> Map::check(Actor *actor, Vector2D coord)
+int Map::get_cell_bucket(int cell) const
 {
-    if (this->isMapping)
+    return this->cell_bucket[cell];
+}
+
+void Map::get_neighbour_buckets(int bucket, int neighbour[9]) const
+{
+    int k = 0;
+    for (int dy = -this->width; dy <= this->width; dy += this->width)
+        for (int dx = -1; dx <= 1; dx++)
+            neighbour[k++] = bucket + dy + dx;
+}
+
+void Map::get_half_neighbour_buckets(int bucket, int neighbour[5]) const
+{
+    neighbour[0] = bucket;
+    neighbour[1] = bucket + 1;
+    neighbour[2] = bucket + this->width - 1;
+    neighbour[3] = bucket + this->width;
+    neighbour[4] = bucket + this->width + 1;
+}
+
+void Map::get_cells_within(Vector2D coord, double distance, std::vector<int> *cells) const
+{
+    // the clamping of get_bucket never moves two buckets apart, so the rings around the
+    // bucket of coord hold every cell within distance
+    int bucket = this->get_bucket(coord);
+    int n_rings = (int)ceil(distance / this->cell_size);
+    int column = bucket % this->width;
+    int first_column = std::max(column - n_rings, 0);
+    int end_column = std::min(column + n_rings + 1, this->width);
+    int row = bucket / this->width;
+    for (int r = std::max(row - n_rings, 0); r < std::min(row + n_rings + 1, this->height); r++)
     {
-        int x = (int)((coord[0] - this->left) / cell_size);
-        int y = (int)((coord[1] - this->top) / cell_size);
-        std::set<Actor *> merged = cell[y * this->width + x];
-        merged.insert(cell[y * this->width + x + 1].begin(), cell[y * this->width + x + 1].end());
-        merged.insert(cell[y * this->width + x - 1].begin(), cell[y * this->width + x - 1].end());
-        merged.insert(cell[(y + 1) * this->width + x].begin(), cell[(y + 1) * this->width + x].end());
-        merged.insert(cell[(y - 1) * this->width + x].begin(), cell[(y - 1) * this->width + x].end());
-        merged.insert(cell[(y - 1) * this->width + x - 1].begin(), cell[(y - 1) * this->width + x - 1].end());
-        merged.insert(cell[(y - 1) * this->width + x + 1].begin(), cell[(y - 1) * this->width + x + 1].end());
-        merged.insert(cell[(y + 1) * this->width + x - 1].begin(), cell[(y + 1) * this->width + x - 1].end());
-        merged.insert(cell[(y + 1) * this->width + x + 1].begin(), cell[(y + 1) * this->width + x + 1].end());
-        merged.erase(actor);
-        return merged;
+        // the buckets of the row are contiguous, only the window is up to date
+        int begin = std::min(std::max(r * this->width + first_column, this->window_begin), this->window_end);
+        int end = std::min(std::max(r * this->width + end_column, this->window_begin), this->window_end);
+        cells->insert(cells->end(), this->sorted_cell.data() + this->bucket_start[begin], this->sorted_cell.data() + this->bucket_start[end]);
     }
-    else
-        return std::set<Actor *>();
+}
+
+const int *Map::cells_begin(int bucket) const
+{
+    return this->sorted_cell.data() + this->bucket_start[bucket];
+}
+const int *Map::cells_end(int bucket) const
+{
+    return this->sorted_cell.data() + this->bucket_start[bucket + 1];
+}
+int Map::get_first_row() const
+{
+    return this->window_begin / std::max(this->width, 1);
+}
+int Map::get_end_row() const
+{
+    return this->window_end / std::max(this->width, 1) + 1;
+}
+// cells of the buckets of a row, in bucket order
+const int *Map::row_cells_begin(int row) const
+{
+    int bucket = std::min(std::max(row * this->width, this->window_begin), this->window_end);
+    return this->sorted_cell.data() + this->bucket_start[bucket];
+}
+const int *Map::row_cells_end(int row) const
+{
+    return this->row_cells_begin(row + 1);
 }
 
 std::string Map::to_string() const
 {
     std::stringstream strm;
-    for (unsigned int i = 0; i < cell.size(); i++)
+    for (int i = 0; i < this->height * this->width; i++)
     {
         if (i % this->width == 0)
             strm << "\n";
-        strm << cell[i].size() << " ";
+        if (i >= this->window_begin && i < this->window_end)
+            strm << this->bucket_start[i + 1] - this->bucket_start[i] << " ";
+        else
+            strm << 0 << " ";
     }
     strm << "\n";
     return strm.str();
-}
\ No newline at end of file
+}
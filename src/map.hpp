@@ -1,14 +1,16 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include <string>
 #include <vector>
-#include <set>
 #include "definition.hpp"
-#include "actor.hpp"
+#include "stepPool.hpp"
 
+// Uniform grid used for the neighbour search.
+// Cells are stored as a cell list: every step the cell indices are counting-sorted by
+// bucket, so the cells of a bucket are a contiguous range of sorted_cell.
 class Map
 {
-    std::vector<std::set<Actor *>> cell;
     double cell_size;
     double top;
     double left;
@@ -16,15 +18,30 @@ class Map
     int width;
     bool isMapping;
 
+    std::vector<int> bucket_start;     // height * width + 1 offsets into sorted_cell
+    std::vector<int> sorted_cell;
+    std::vector<int> cell_bucket;
+    int window_begin, window_end;      // range of bucket_start that is up to date
+
     public:
     Map(double top, double bottom, double left, double right, double cell_size);
 
-    void depart(Actor* actor, Vector2D coord);
-    void arrive(Actor* actor, Vector2D coord);
-    std::set<Actor *> check(Actor* actor, Vector2D coord);
-    void horizontal(Actor *actor, double yy);
-    void vertical(Actor *actor, double xx);
+    bool is_mapping() const;
+    int get_bucket(Vector2D coord) const;
+    void rebuild(const double *x, const double *y, int n_cells, StepPool &pool);
+    int get_cell_bucket(int cell) const;
+    void get_neighbour_buckets(int bucket, int neighbour[9]) const;
+    void get_half_neighbour_buckets(int bucket, int neighbour[5]) const;
+    // appends the cells of the buckets that can hold a point within distance of coord, a
+    // superset of the cells within distance
+    void get_cells_within(Vector2D coord, double distance, std::vector<int> *cells) const;
+    const int *cells_begin(int bucket) const;
+    const int *cells_end(int bucket) const;
+    int get_first_row() const;
+    int get_end_row() const;
+    const int *row_cells_begin(int row) const;
+    const int *row_cells_end(int row) const;
     std::string to_string() const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,174 @@
+#include "multiTauCorrelator.hpp"
+#include <algorithm>
+#include <cmath>
+
+MultiTauCorrelator::MultiTauCorrelator(int points_per_level, int n_states, double saved_time_step)
+{
+    this->points_per_level = std::max(4, points_per_level / 2 * 2);
+    this->n_states = n_states;
+    this->saved_time_step = saved_time_step;
+    // enough levels for the longest lag, n_states - 1
+    this->n_levels = 1;
+    while ((long)(this->points_per_level - 1) << (this->n_levels - 1) < n_states - 1)
+        this->n_levels++;
+    this->n_cells = 0;
+    this->n_pushed = 0;
+
+    for (int level = 0; level < this->n_levels; level++)
+        for (int point_lag = this->_get_first_lag(level); point_lag < this->points_per_level; point_lag++)
+            this->lag.push_back(point_lag << level);
+    int n_lags = this->lag.size();
+    this->msd = std::vector<double>(n_lags, 0.);
+    this->velocity = std::vector<double>(n_lags, 0.);
+    this->orientation = std::vector<double>(n_lags, 0.);
+    this->n_pairs = std::vector<long>(n_lags, 0);
+    this->n_velocity_pairs = std::vector<long>(n_lags, 0);
+}
+
+// level 0 has the lags from 0, a coarser level only the ones the finer level misses
+int MultiTauCorrelator::_get_first_lag(int level) const
+{
+    return level == 0 ? 0 : this->points_per_level / 2;
+}
+
+int MultiTauCorrelator::_get_lag_index(int level, int point_lag) const
+{
+    if (level == 0)
+        return point_lag;
+    return this->points_per_level + (level - 1) * (this->points_per_level / 2) + point_lag - this->points_per_level / 2;
+}
+
+void MultiTauCorrelator::push(const SnapshotView &snapshot)
+{
+    if (this->n_pushed >= this->n_states)
+        return;
+    int p = this->points_per_level;
+    int n_levels = this->n_levels;
+    int k = this->n_pushed;
+    if (k == 0)
+    {
+        this->n_cells = snapshot.size();
+        this->sample = std::vector<Sample>(this->n_cells * n_levels * p, Sample{0., 0., 0., 0., 0., 0.});
+        this->last_x = std::vector<double>(this->n_cells, 0.);
+        this->last_y = std::vector<double>(this->n_cells, 0.);
+    }
+
+    // state k is kept by the levels l where k is a multiple of 2^l
+    for (int i = 0; i < this->n_cells; i++)
+    {
+        const CellInstance &instance = snapshot[i];
+        Sample *cell_sample = &this->sample[i * n_levels * p];
+        Sample &state = cell_sample[k % p];
+        state.x = instance.coord[0];
+        state.y = instance.coord[1];
+        state.e_x = cos(instance.direction);
+        state.e_y = sin(instance.direction);
+        state.v_x = k > 0 ? (state.x - this->last_x[i]) / this->saved_time_step : 0.;
+        state.v_y = k > 0 ? (state.y - this->last_y[i]) / this->saved_time_step : 0.;
+        this->last_x[i] = state.x;
+        this->last_y[i] = state.y;
+        for (int level = 1; level < n_levels && k % (1 << level) == 0; level++)
+            cell_sample[level * p + (k >> level) % p] = state;
+    }
+
+    for (int level = 0; level < n_levels && k % (1 << level) == 0; level++)
+    {
+        int count = k >> level; // states of the level before this one
+        int point = count % p;
+        for (int point_lag = this->_get_first_lag(level); point_lag <= std::min(count, p - 1); point_lag++)
+        {
+            int older = (point - point_lag + p) % p;
+            double sum_msd = 0., sum_velocity = 0., sum_orientation = 0.;
+            for (int i = 0; i < this->n_cells; i++)
+            {
+                const Sample *ring = &this->sample[(i * n_levels + level) * p];
+                const Sample &a = ring[older];
+                const Sample &b = ring[point];
+                sum_msd += (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y);
+                sum_velocity += a.v_x * b.v_x + a.v_y * b.v_y;
+                sum_orientation += a.e_x * b.e_x + a.e_y * b.e_y;
+            }
+            int index = this->_get_lag_index(level, point_lag);
+            this->msd[index] += sum_msd;
+            this->orientation[index] += sum_orientation;
+            this->n_pairs[index] += this->n_cells;
+            // the first state has no velocity
+            if (k - (point_lag << level) >= 1)
+            {
+                this->velocity[index] += sum_velocity;
+                this->n_velocity_pairs[index] += this->n_cells;
+            }
+        }
+    }
+    this->n_pushed++;
+}
+
+void MultiTauCorrelator::merge(const MultiTauCorrelator &other)
+{
+    for (unsigned int i = 0; i < this->lag.size(); i++)
+    {
+        this->msd[i] += other.msd[i];
+        this->velocity[i] += other.velocity[i];
+        this->orientation[i] += other.orientation[i];
+        this->n_pairs[i] += other.n_pairs[i];
+        this->n_velocity_pairs[i] += other.n_velocity_pairs[i];
+    }
+}
+
+int MultiTauCorrelator::get_n_lags() const
+{
+    return this->lag.size();
+}
+
+double MultiTauCorrelator::get_lag_time(int lag) const
+{
+    return this->lag[lag] * this->saved_time_step;
+}
+
+long MultiTauCorrelator::get_n_pairs(int lag) const
+{
+    return this->n_pairs[lag];
+}
+
+double MultiTauCorrelator::get_msd(int lag) const
+{
+    return this->n_pairs[lag] > 0 ? this->msd[lag] / this->n_pairs[lag] : 0.;
+}
+
+double MultiTauCorrelator::get_velocity(int lag) const
+{
+    return this->n_velocity_pairs[lag] > 0 ? this->velocity[lag] / this->n_velocity_pairs[lag] : 0.;
+}
+
+double MultiTauCorrelator::get_orientation(int lag) const
+{
+    return this->n_pairs[lag] > 0 ? this->orientation[lag] / this->n_pairs[lag] : 0.;
+}
+
+void MultiTauCorrelator::save_state(CheckpointWriter &out) const
+{
+    out.write(this->n_cells);
+    out.write(this->n_pushed);
+    out.write(this->sample);
+    out.write(this->last_x);
+    out.write(this->last_y);
+    out.write(this->msd);
+    out.write(this->velocity);
+    out.write(this->orientation);
+    out.write(this->n_pairs);
+    out.write(this->n_velocity_pairs);
+}
+
+void MultiTauCorrelator::load_state(CheckpointReader &in)
+{
+    in.read(&this->n_cells);
+    in.read(&this->n_pushed);
+    in.read(&this->sample);
+    in.read(&this->last_x);
+    in.read(&this->last_y);
+    in.read(&this->msd);
+    in.read(&this->velocity);
+    in.read(&this->orientation);
+    in.read(&this->n_pairs);
+    in.read(&this->n_velocity_pairs);
+}
@@ -0,0 +1,67 @@
+#ifndef MULTI_TAU_CORRELATOR_H
+#define MULTI_TAU_CORRELATOR_H
+
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "population.hpp"
+
+// Time-averaged correlations of the saved states of every cell, from every time origin:
+// mean squared displacement, velocity autocorrelation and orientation autocorrelation
+// <e(t0).e(t0 + t)>, with the multiple-tau scheme. Level 0 holds the last points_per_level
+// states and correlates them at lags 0 to points_per_level - 1; level l holds one state out
+// of 2^l and adds the lags points_per_level / 2 to points_per_level - 1 in units of 2^l.
+// The lags up to T saved states take O(points_per_level log T) memory per cell and the
+// states are correlated as they are pushed. The levels subsample the states rather than
+// averaging them, so each lag is exact, only the number of time origins decreases with it.
+// The velocity is the displacement between two saved states over their time.
+class MultiTauCorrelator
+{
+    struct Sample
+    {
+        double x, y;
+        double e_x, e_y; // orientation
+        double v_x, v_y;
+    };
+
+    int points_per_level; // even
+    int n_levels;
+    int n_states;
+    int n_cells;
+    double saved_time_step;
+    int n_pushed; // states so far
+
+    // ring of the last points_per_level states, [cell][level][point]
+    std::vector<Sample> sample;
+    std::vector<double> last_x, last_y; // per cell, for the velocity
+
+    std::vector<int> lag; // in saved states, level 0 then the coarser levels
+    // sums over the pairs of states and the cells, per lag
+    std::vector<double> msd, velocity, orientation;
+    std::vector<long> n_pairs, n_velocity_pairs;
+
+  public:
+    // correlates the first n_states states at lags up to n_states - 1, points_per_level is
+    // rounded to an even number of at least 4
+    MultiTauCorrelator(int points_per_level, int n_states, double saved_time_step);
+    // the next state of every cell, ignored after the first n_states
+    void push(const SnapshotView &snapshot);
+    // adds the sums of the cells of another run, the states being correlated are not merged
+    void merge(const MultiTauCorrelator &other);
+    int get_n_lags() const;
+    double get_lag_time(int lag) const;
+    // pairs of states correlated at the lag, over the cells
+    long get_n_pairs(int lag) const;
+    // means over the cells and the time origins, 0 if the lag was not reached
+    double get_msd(int lag) const;
+    double get_velocity(int lag) const;
+    double get_orientation(int lag) const;
+    void save_state(CheckpointWriter &out) const;
+    void load_state(CheckpointReader &in);
+
+  protected:
+    int _get_first_lag(int level) const;
+    int _get_lag_index(int level, int point_lag) const;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "pairForce.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+PairForce::PairForce(const CellParameters &parameters)
+{
+    double cutoff_factor_2 = 1.122462 * 1.122462; // 2^(1/6)
+    double body_body_radius = parameters.body_radius * 2;
+    double body_flagella_radius = parameters.body_radius + parameters.flagella_radius;
+    double flagella_flagella_radius = parameters.flagella_radius * 2;
+
+    this->body_body_24 = 24 * 10.; //cell hardness
+    this->body_body_6 = parameters._body_body_6;
+    this->body_body_12 = 2 * parameters._body_body_6 * parameters._body_body_6;
+    this->body_body_cutoff_2 = body_body_radius * body_body_radius * cutoff_factor_2;
+
+    this->body_flagella_24 = 24 * 1.; //cell hardness
+    this->body_flagella_6 = parameters._body_flagella_6;
+    this->body_flagella_12 = 2 * parameters._body_flagella_6 * parameters._body_flagella_6;
+    this->body_flagella_cutoff_2 = body_flagella_radius * body_flagella_radius * cutoff_factor_2;
+
+    this->flagella_flagella_24 = 24 * 1.; //cell hardness
+    this->flagella_flagella_6 = parameters._flagella_flagella_6;
+    this->flagella_flagella_12 = 2 * parameters._flagella_flagella_6 * parameters._flagella_flagella_6;
+    this->flagella_flagella_cutoff_2 = flagella_flagella_radius * flagella_flagella_radius * cutoff_factor_2;
+
+    double cutoff_factor = 1.122462;
+    this->reach = std::max(std::max(body_body_radius * cutoff_factor, parameters.body_flagella_distance + body_flagella_radius * cutoff_factor),
+                           2 * parameters.body_flagella_distance + flagella_flagella_radius * cutoff_factor);
+}
+
+double PairForce::get_reach() const
+{
+    return this->reach;
+}
+
+// force on the first sphere divided by its distance from the second one, zero beyond the cutoff
+static inline double lj_force_over_distance(double distance_2, double hardness_24, double sigma_6, double sigma_12, double cutoff_2)
+{
+    if (distance_2 >= cutoff_2)
+        return 0.;
+    double inv_2 = 1. / distance_2;
+    double inv_6 = inv_2 * inv_2 * inv_2;
+    return hardness_24 * inv_2 * inv_6 * (sigma_12 * inv_6 - sigma_6);
+}
+
+// returns true when some spheres of the two cells are within the cutoff
+bool PairForce::_add_pair(int i, int j, std::vector<CellForce> &force) const
+{
+    Vector2D coord;
+    double factor;
+    bool within_cutoff = false;
+
+    coord = this->body[i] - this->body[j];
+    factor = lj_force_over_distance(coord.square(), this->body_body_24, this->body_body_6, this->body_body_12, this->body_body_cutoff_2);
+    force[i].body += coord * factor;
+    force[j].body -= coord * factor;
+    within_cutoff |= factor != 0.;
+
+    coord = this->body[i] - this->flagella[j];
+    factor = lj_force_over_distance(coord.square(), this->body_flagella_24, this->body_flagella_6, this->body_flagella_12, this->body_flagella_cutoff_2);
+    force[i].body += coord * factor;
+    force[j].flagella -= coord * factor;
+    within_cutoff |= factor != 0.;
+
+    coord = this->flagella[i] - this->body[j];
+    factor = lj_force_over_distance(coord.square(), this->body_flagella_24, this->body_flagella_6, this->body_flagella_12, this->body_flagella_cutoff_2);
+    force[i].flagella += coord * factor;
+    force[j].body -= coord * factor;
+    within_cutoff |= factor != 0.;
+
+    coord = this->flagella[i] - this->flagella[j];
+    factor = lj_force_over_distance(coord.square(), this->flagella_flagella_24, this->flagella_flagella_6, this->flagella_flagella_12, this->flagella_flagella_cutoff_2);
+    force[i].flagella += coord * factor;
+    force[j].flagella -= coord * factor;
+    return within_cutoff || factor != 0.;
+}
+
+void PairForce::add_forces(const Population &population, const Map &map, std::vector<CellForce> &force, StepPool &pool)
+{
+    PROFILE_SCOPE(PROFILE_PAIR_FORCES);
+    int n_cells = population.size();
+    this->body.resize(n_cells);
+    this->flagella.resize(n_cells);
+    const double *x = population.get_x();
+    const double *y = population.get_y();
+    const double *direction = population.get_direction();
+    double body_flagella_distance = population.get_parameters().body_flagella_distance;
+    pool.run_range(n_cells, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+        {
+            this->body[i] = Vector2D{x[i], y[i]};
+            this->flagella[i] = this->body[i] + Vector2D{cos(direction[i]), sin(direction[i])} * body_flagella_distance;
+        }
+    });
+
+    // The grid is cut in stripes of two rows. A cell only writes to cells of its own row and
+    // of the next one, so stripes of the same parity never write to the same cell and are
+    // computed in parallel, first the even ones and then the odd ones. The order in which the
+    // contributions are summed is then fixed and does not depend on the number of threads.
+    int first_row = map.get_first_row();
+    int n_stripes = (map.get_end_row() - first_row + 1) / 2;
+    for (int parity = 0; parity < 2; parity++)
+        pool.run((n_stripes - parity + 1) / 2, [&](int task) {
+            int row = first_row + 2 * (2 * task + parity);
+            this->_add_stripe(map, map.row_cells_begin(row), map.row_cells_end(row + 1), force);
+        });
+}
+
+void PairForce::add_pair_forces(const Population &population, const std::vector<std::pair<int, int>> &pairs, std::vector<CellForce> &force)
+{
+    PROFILE_SCOPE(PROFILE_PAIR_FORCES);
+    int n_cells = population.size();
+    this->body.resize(n_cells);
+    this->flagella.resize(n_cells);
+    double body_flagella_distance = population.get_parameters().body_flagella_distance;
+    for (const std::pair<int, int> &pair : pairs)
+        for (int i : {pair.first, pair.second})
+        {
+            this->body[i] = population.get_coord(i);
+            this->flagella[i] = this->body[i] + Vector2D{cos(population.get_direction()[i]), sin(population.get_direction()[i])} * body_flagella_distance;
+        }
+    long n_within_cutoff = 0;
+    for (const std::pair<int, int> &pair : pairs)
+        n_within_cutoff += this->_add_pair(pair.first, pair.second, force);
+    PROFILE_COUNT(PROFILE_PAIRS_TESTED, (long)pairs.size());
+    PROFILE_COUNT(PROFILE_PAIRS_WITHIN_CUTOFF, n_within_cutoff);
+}
+
+void PairForce::_add_stripe(const Map &map, const int *cells_begin, const int *cells_end, std::vector<CellForce> &force) const
+{
+    // counted per stripe, the totals are only used by the profiling build
+    long n_tested = 0, n_within_cutoff = 0;
+    for (const int *i = cells_begin; i != cells_end; ++i)
+    {
+        // half of the 3x3 stencil: the own bucket and the four buckets after it, so that
+        // every pair of neighbouring buckets is visited from one side only
+        int neighbour[5];
+        map.get_half_neighbour_buckets(map.get_cell_bucket(*i), neighbour);
+        for (const int *j = map.cells_begin(neighbour[0]); j != map.cells_end(neighbour[0]); ++j)
+            if (*j > *i)
+            {
+                n_within_cutoff += this->_add_pair(*i, *j, force);
+                n_tested++;
+            }
+        for (int b = 1; b < 5; b++)
+            for (const int *j = map.cells_begin(neighbour[b]); j != map.cells_end(neighbour[b]); ++j)
+            {
+                n_within_cutoff += this->_add_pair(*i, *j, force);
+                n_tested++;
+            }
+    }
+    PROFILE_COUNT(PROFILE_PAIRS_TESTED, n_tested);
+    PROFILE_COUNT(PROFILE_PAIRS_WITHIN_CUTOFF, n_within_cutoff);
+}
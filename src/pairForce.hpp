@@ -0,0 +1,38 @@
+#ifndef PAIR_FORCE_H
+#define PAIR_FORCE_H
+
+#include <vector>
+#include "definition.hpp"
+#include "population.hpp"
+#include "map.hpp"
+#include "stepPool.hpp"
+
+// Repulsive Lennard-Jones forces between the spheres (body and flagella) of different
+// cells. Each unordered pair of neighbouring cells is visited once and the equal and
+// opposite contributions are added to both cells.
+class PairForce
+{
+    // per sphere pair: 24 * hardness, sigma^6, 2 * sigma^12 and squared cutoff
+    double body_body_24, body_body_6, body_body_12, body_body_cutoff_2;
+    double body_flagella_24, body_flagella_6, body_flagella_12, body_flagella_cutoff_2;
+    double flagella_flagella_24, flagella_flagella_6, flagella_flagella_12, flagella_flagella_cutoff_2;
+    double reach;
+
+    // positions the forces are computed from, filled once per step
+    std::vector<Vector2D> body, flagella;
+
+  public:
+    PairForce(const CellParameters &parameters);
+    // largest distance between the bodies of two interacting cells
+    double get_reach() const;
+    // forces of all the pairs found by the map, from the current state of the cells
+    void add_forces(const Population &population, const Map &map, std::vector<CellForce> &force, StepPool &pool);
+    // forces of the listed pairs only, from the current state of the cells
+    void add_pair_forces(const Population &population, const std::vector<std::pair<int, int>> &pairs, std::vector<CellForce> &force);
+
+  protected:
+    void _add_stripe(const Map &map, const int *cells_begin, const int *cells_end, std::vector<CellForce> &force) const;
+    bool _add_pair(int i, int j, std::vector<CellForce> &force) const;
+};
+
+#endif
@@ -0,0 +1,467 @@
+#include "population.hpp"
+#include "integrator.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+CellParameters::CellParameters(nlohmann::json physics_parameters)
+{
+    nlohmann::json shape = physics_parameters["shape"];
+    this->body_radius = shape["body"]["radius"].get<double>();
+    this->flagella_radius = shape["flagella"]["radius"].get<double>();
+    this->body_flagella_distance = std::max(this->body_radius, this->flagella_radius);
+    this->rotation_center = shape["rotationCenter"].get<double>();
+
+    this->speed = physics_parameters["propulsion"]["speed"].get<double>();
+
+    nlohmann::json tumble = physics_parameters["propulsion"]["tumble"];
+    this->tumble_delay_mean = tumble["delay"].get<double>();
+    this->tumble_duration_mean = tumble["duration"]["mean"].get<double>();
+    this->tumble_duration_std = this->tumble_duration_mean * tumble["duration"]["_std"].get<double>();
+    this->tumble_strength_mean = tumble["strength"]["mean"].get<double>();
+    this->tumble_strength_std = this->tumble_strength_mean * tumble["strength"]["_std"].get<double>();
+
+    nlohmann::json fluid_interaction = physics_parameters["fluidCellInteraction"];
+    this->diffusivity = fluid_interaction["diffusivity"].get<double>();
+    this->_sqrt_diffusivity = sqrt(this->diffusivity);
+    this->shear_time = fluid_interaction["shearTime"].get<double>();
+
+    nlohmann::json noise = physics_parameters["noise"];
+    this->_sqrt_noise_force_strength = sqrt(noise["force"]["strength"].get<double>());
+    this->_sqrt_noise_torque_strength = sqrt(noise["torque"]["strength"].get<double>());
+
+    this->_body_body_6 = pow(this->body_radius * 2, 6.);
+    this->_body_flagella_6 = pow(this->body_radius + this->flagella_radius, 6.);
+    this->_flagella_flagella_6 = pow(this->flagella_radius * 2, 6.);
+}
+
+Population::Population(nlohmann::json physics_parameters, nlohmann::json initial_conditions, nlohmann::json simulation_parameters, CounterRng random_generator)
+    : parameters(physics_parameters)
+{
+    this->throw_errors = simulation_parameters["throw_errors"];
+    this->history_size = simulation_parameters["visualization"].get<bool>() ? simulation_parameters["n_saved_time_steps"].get<int>() + 1 : 2;
+    this->random_generator = random_generator;
+    this->delta_time_step = simulation_parameters["time_step"].get<double>();
+    this->step_size = simulation_parameters["saved_time_step_size"].get<int>();
+
+    this->n_cells = initial_conditions.size();
+    this->instance = std::vector<CellInstance>(this->n_cells * this->history_size, CellInstance({0., 0.}, 0., 0., 0., 0.));
+    for (std::vector<double> *field : {&this->x, &this->y, &this->direction, &this->next_x, &this->next_y, &this->next_direction, &this->tumble_end, &this->tumble_speed})
+        *field = std::vector<double>(this->n_cells, 0.);
+    // the first tumble starts with the simulation
+    this->tumble_time = std::vector<double>(this->n_cells, this->parameters.tumble_strength_mean == 0. ? std::numeric_limits<double>::infinity() : 0.);
+    this->tumble_count = std::vector<int>(this->n_cells, 0);
+    this->rotation = std::vector<double>(this->n_cells, 0.);
+    for (std::vector<double> *noise : {&this->noise_x, &this->noise_y, &this->noise_torque, &this->noise_spare})
+        *noise = std::vector<double>(this->n_cells, 0.);
+
+    for (int i = 0; i < this->n_cells; i++)
+    {
+        this->x[i] = initial_conditions[i]["position"]["x"].get<double>();
+        this->y[i] = initial_conditions[i]["position"]["y"].get<double>();
+        this->direction[i] = initial_conditions[i]["direction"].get<double>();
+        this->instance[i] = CellInstance({this->x[i], this->y[i]}, this->direction[i], 0., 0., 0.);
+    }
+
+    const CellParameters &p = this->parameters;
+    TumbleModel tumble_model = p.tumble_strength_mean == 0. ? NO_TUMBLE : p.tumble_duration_mean == 0. ? INSTANT_TUMBLE : RUNNING_TUMBLE;
+    bool off_center = p.rotation_center != 0.;
+    // kernels without the branches that are dead for this cell model
+    switch (tumble_model)
+    {
+    case NO_TUMBLE:
+        this->tumble = &Population::_tumble<NO_TUMBLE>;
+        this->compute_range = off_center ? &Population::_compute_range<true, NO_TUMBLE> : &Population::_compute_range<false, NO_TUMBLE>;
+        break;
+    case INSTANT_TUMBLE:
+        this->tumble = &Population::_tumble<INSTANT_TUMBLE>;
+        this->compute_range = off_center ? &Population::_compute_range<true, INSTANT_TUMBLE> : &Population::_compute_range<false, INSTANT_TUMBLE>;
+        break;
+    case RUNNING_TUMBLE:
+        this->tumble = &Population::_tumble<RUNNING_TUMBLE>;
+        this->compute_range = off_center ? &Population::_compute_range<true, RUNNING_TUMBLE> : &Population::_compute_range<false, RUNNING_TUMBLE>;
+        break;
+    }
+    this->rotate = off_center ? integrate_rotation<true> : integrate_rotation<false>;
+}
+
+void Population::compute_step(int now, double delta_time_step, const std::vector<CellForce> &force, int *n_errors, StepPool &pool, const BrownianBridge *bridge)
+{
+    PROFILE_SCOPE(PROFILE_INTEGRATION);
+    StepConstants constants = this->_step_constants(delta_time_step);
+
+    // every cell is independent, so each thread updates a contiguous range of cells
+    std::atomic<int> n_clamped(0);
+    pool.run_range(this->n_cells, [&](int begin, int end) {
+        n_clamped += (this->*compute_range)(now, delta_time_step, constants, force.data(), bridge, begin, end);
+    });
+    PROFILE_COUNT(PROFILE_CLAMPED_FORCES, n_clamped.load());
+
+    if (n_clamped > 0)
+    {
+        *n_errors += n_clamped;
+        if (this->throw_errors)
+            for (int i = 0; i < this->n_cells; i++)
+                this->_check_force(i, now, force[i], constants.mobility);
+    }
+}
+
+StepConstants Population::_step_constants(double delta_time_step) const
+{
+    const CellParameters &p = this->parameters;
+    double sqrt_delta_time_step = sqrt(delta_time_step);
+    StepConstants constants;
+    constants.drift = p.speed * delta_time_step;
+    constants.mobility = p.diffusivity * delta_time_step;
+    constants.force_noise = SQRT_2 * p._sqrt_diffusivity * p._sqrt_noise_force_strength * sqrt_delta_time_step;
+    constants.torque_noise = SQRT_2 * p._sqrt_noise_torque_strength * sqrt_delta_time_step;
+    constants.body_lever = -p.rotation_center;
+    constants.flagella_lever = p.body_flagella_distance - p.rotation_center;
+    constants.rotational_mobility = delta_time_step / p.shear_time;
+    return constants;
+}
+
+void Population::_check_force(int cell, int now, const CellForce &force, double mobility) const
+{
+    if (((force.body + force.flagella) * mobility).square() > 9.)
+    {
+        std::stringstream strm;
+        strm << "Force on cell too strong";
+        strm << "pos x" << this->x[cell];
+        strm << "pos y" << this->y[cell];
+        strm << "\n\nCell's state before the step:\n"
+             << this->state_to_string(cell, now - 1);
+        throw strm.str();
+    }
+}
+
+void Population::_commit(int cell, int last_step)
+{
+    this->x[cell] = this->next_x[cell];
+    this->y[cell] = this->next_y[cell];
+    this->direction[cell] = this->next_direction[cell];
+    this->_apply_tumble(cell, last_step * this->delta_time_step);
+}
+
+// the cells are few, each one is computed on its own with the noise of the fixed steps
+void Population::compute_cells_step(const std::vector<int> &cells, int now, double delta_time_step, const std::vector<CellForce> &force, int *n_errors)
+{
+    PROFILE_SCOPE(PROFILE_INTEGRATION);
+    StepConstants constants = this->_step_constants(delta_time_step);
+    int n_clamped = 0;
+    for (int i : cells)
+    {
+        n_clamped += (this->*compute_range)(now, delta_time_step, constants, force.data(), nullptr, i, i + 1);
+        if (this->throw_errors)
+            this->_check_force(i, now, force[i], constants.mobility);
+        this->_commit(i, now);
+    }
+    PROFILE_COUNT(PROFILE_CLAMPED_FORCES, n_clamped);
+    *n_errors += n_clamped;
+}
+
+// Computed for every cell, which costs a single pass per slot, and kept for the listed ones.
+// The rotation must be steady along the step: no tumble starts and a running one does not
+// end, as checked by the caller.
+void Population::compute_free_step(const std::vector<int> &cells, int now, int n_steps, double delta_time_step, StepPool &pool)
+{
+    PROFILE_SCOPE(PROFILE_INTEGRATION);
+    double step_time = n_steps * delta_time_step;
+    StepConstants constants = this->_step_constants(step_time);
+    // the rotational diffusivity is the strength of the noise torque
+    double drift_decay = exp(-this->parameters._sqrt_noise_torque_strength * this->parameters._sqrt_noise_torque_strength * step_time / 6.);
+    pool.run_range(this->n_cells, [&](int begin, int end) {
+        // streams 5 and 6 of the first time step, the noise of the whole step
+        this->random_generator.fill_gaussian_pair(begin, end, now, 5, this->noise_x.data(), this->noise_y.data());
+        this->random_generator.fill_gaussian_pair(begin, end, now, 6, this->noise_torque.data(), this->noise_spare.data());
+        for (int i = begin; i < end; i++)
+            this->rotation[i] = this->noise_torque[i] * constants.torque_noise;
+        (this->*tumble)(now, step_time, begin, end);
+        int n = end - begin;
+        integrate_free(n, constants, drift_decay, this->x.data() + begin, this->y.data() + begin, this->direction.data() + begin,
+                       this->noise_x.data() + begin, this->noise_y.data() + begin, this->rotation.data() + begin,
+                       this->next_x.data() + begin, this->next_y.data() + begin);
+        this->rotate(n, this->parameters.rotation_center, this->direction.data() + begin, this->rotation.data() + begin,
+                     this->next_x.data() + begin, this->next_y.data() + begin, this->next_direction.data() + begin);
+    });
+    for (int i : cells)
+        this->_commit(i, now + n_steps - 1);
+}
+
+template <bool off_center, TumbleModel tumble_model>
+int Population::_compute_range(int now, double delta_time_step, const StepConstants &constants, const CellForce *force, const BrownianBridge *bridge, int begin, int end)
+{
+    // batched noise: the increments of the bridge interval, or streams 0 and 1 of every (cell, step) counter
+    if (bridge)
+        bridge->get_noise(begin, end, this->noise_x.data(), this->noise_y.data(), this->noise_torque.data());
+    else
+    {
+        this->random_generator.fill_gaussian_pair(begin, end, now, 0, this->noise_x.data(), this->noise_y.data());
+        this->random_generator.fill_gaussian_pair(begin, end, now, 1, this->noise_torque.data(), this->noise_spare.data());
+    }
+
+    int n = end - begin;
+    int n_clamped = integrate_translation<off_center>(n, constants, this->x.data() + begin, this->y.data() + begin, this->direction.data() + begin, force + begin,
+                                                      this->noise_x.data() + begin, this->noise_y.data() + begin, this->noise_torque.data() + begin,
+                                                      this->next_x.data() + begin, this->next_y.data() + begin, this->rotation.data() + begin);
+    this->_tumble<tumble_model>(now, delta_time_step, begin, end);
+    integrate_rotation<off_center>(n, this->parameters.rotation_center, this->direction.data() + begin, this->rotation.data() + begin,
+                                   this->next_x.data() + begin, this->next_y.data() + begin, this->next_direction.data() + begin);
+    return n_clamped;
+}
+
+// adds the rotation of the tumbles along the step, the events inside it are only read
+template <TumbleModel tumble_model>
+void Population::_tumble(int now, double delta_time_step, int begin, int end)
+{
+    if (tumble_model == NO_TUMBLE)
+        return;
+    double step_begin = (now - 1) * this->delta_time_step;
+    double step_end = step_begin + delta_time_step;
+    for (int i = begin; i < end; i++)
+    {
+        if (this->tumble_time[i] < step_end)
+        {
+            TumbleState state = this->_get_tumble(i);
+            this->rotation[i] += this->_advance_tumble(i, step_begin, step_end, state);
+        }
+        // instantaneous tumbles have no speed
+        else if (tumble_model == RUNNING_TUMBLE && this->tumble_end[i] > step_begin)
+            this->rotation[i] += this->tumble_speed[i] * (std::min(step_end, this->tumble_end[i]) - step_begin);
+    }
+}
+
+TumbleState Population::_get_tumble(int cell) const
+{
+    return TumbleState{this->tumble_time[cell], this->tumble_end[cell], this->tumble_speed[cell], this->tumble_count[cell]};
+}
+
+// rotation of the tumbles between begin and end, the state is moved past the tumbles that
+// start before end. The random numbers of a tumble are drawn with its number as counter, so
+// the tumbles do not depend on the steps they fall in.
+double Population::_advance_tumble(int cell, double begin, double end, TumbleState &state) const
+{
+    const CellParameters &p = this->parameters;
+    double rotation = 0.;
+    while (state.time < end)
+    {
+        // the last tumble stops when the next one starts
+        rotation += state.speed * std::max(std::min(state.time, state.end) - begin, 0.);
+        begin = std::max(begin, state.time);
+
+        double gaussian_strength, gaussian_duration, sign, unused;
+        this->random_generator.gaussian_pair(cell, state.count, 2, &gaussian_strength, &gaussian_duration);
+        this->random_generator.uniform_pair(cell, state.count, 3, &sign, &unused);
+        double strength = p.tumble_strength_mean + gaussian_strength * p.tumble_strength_std;
+        strength *= sign <= 0.5 ? -1 : 1;
+        if (p.tumble_duration_mean == 0.) // the tumble is instantaneous
+        {
+            rotation += strength;
+            state.speed = 0.;
+            state.end = state.time;
+        }
+        else // the tumble takes its time
+        {
+            state.speed = strength;
+            state.end = state.time + p.tumble_duration_mean + gaussian_duration * p.tumble_duration_std;
+        }
+        state.time += this->random_generator.exponential(cell, state.count, 4, p.tumble_delay_mean);
+        state.count++;
+    }
+    rotation += state.speed * std::max(std::min(end, state.end) - begin, 0.);
+    return rotation;
+}
+
+// applies the tumbles starting before end, once the step is kept
+void Population::_apply_tumble(int cell, double end)
+{
+    if (this->tumble_time[cell] >= end)
+        return;
+    TumbleState state = this->_get_tumble(cell);
+    this->_advance_tumble(cell, end, end, state);
+    this->tumble_time[cell] = state.time;
+    this->tumble_end[cell] = state.end;
+    this->tumble_speed[cell] = state.speed;
+    this->tumble_count[cell] = state.count;
+}
+
+void Population::update_state(int now, StepPool &pool)
+{
+    PROFILE_SCOPE(PROFILE_STATE_UPDATE);
+    std::swap(this->x, this->next_x);
+    std::swap(this->y, this->next_y);
+    std::swap(this->direction, this->next_direction);
+    double end = now * this->delta_time_step;
+    pool.run_range(this->n_cells, [&](int begin, int end_cell) {
+        for (int i = begin; i < end_cell; i++)
+            this->_apply_tumble(i, end);
+    });
+}
+
+void Population::write_snapshot(int now, StepPool &pool)
+{
+    CellInstance *snapshot = this->instance.data() + (now / this->step_size) % this->history_size * this->n_cells;
+    pool.run_range(this->n_cells, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            snapshot[i] = this->get_instance(i, now);
+    });
+}
+
+bool Population::has_steady_tumble(int cell, int now, int n_steps) const
+{
+    double begin = (now - 1) * this->delta_time_step;
+    double end = begin + n_steps * this->delta_time_step;
+    return this->tumble_time[cell] >= end && (this->tumble_end[cell] <= begin || this->tumble_end[cell] >= end);
+}
+
+double Population::get_move_bound(int cell, int now, int n_steps) const
+{
+    const CellParameters &p = this->parameters;
+    double step_time = n_steps * this->delta_time_step;
+    // the noise is bounded at 7 standard deviations, exceeded with a probability of about 1e-11
+    double translation = p.speed * step_time + 7. * SQRT_2 * p._sqrt_diffusivity * p._sqrt_noise_force_strength * sqrt(step_time);
+    double rotation = 7. * SQRT_2 * p._sqrt_noise_torque_strength * sqrt(step_time) + std::abs(this->tumble_speed[cell]) * step_time;
+    double lever = p.body_flagella_distance + std::abs(p.rotation_center);
+    if (!this->has_steady_tumble(cell, now, n_steps))
+        rotation = 2.;
+    return translation + lever * std::min(rotation, 2.);
+}
+
+double Population::get_max_displacement(StepPool &pool) const
+{
+    std::mutex lock;
+    double max_displacement = 0.;
+    pool.run_range(this->n_cells, [&](int begin, int end) {
+        double range_max = 0.;
+        for (int i = begin; i < end; i++)
+        {
+            double dx = this->next_x[i] - this->x[i];
+            double dy = this->next_y[i] - this->y[i];
+            // bound of the displacement of the flagella, which also moves with the rotation
+            double rotation = std::abs(this->next_direction[i] - this->direction[i]);
+            range_max = std::max(range_max, sqrt(dx * dx + dy * dy) + this->parameters.body_flagella_distance * rotation);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        max_displacement = std::max(max_displacement, range_max);
+    });
+    return max_displacement;
+}
+
+int Population::size() const
+{
+    return this->n_cells;
+}
+const CellParameters &Population::get_parameters() const
+{
+    return this->parameters;
+}
+Vector2D Population::get_coord(int cell) const
+{
+    return Vector2D{this->x[cell], this->y[cell]};
+}
+const double *Population::get_x() const
+{
+    return this->x.data();
+}
+const double *Population::get_y() const
+{
+    return this->y.data();
+}
+const double *Population::get_direction() const
+{
+    return this->direction.data();
+}
+Vector2D Population::get_flagella_coord(CellInstance instance) const
+{
+    return instance.coord + Vector2D{cos(instance.direction), sin(instance.direction)} * this->parameters.body_flagella_distance;
+}
+// the tumble times are relative to the end of time_step
+CellInstance Population::get_instance(int cell, int time_step) const
+{
+    double time = time_step * this->delta_time_step;
+    return CellInstance({this->x[cell], this->y[cell]}, this->direction[cell], this->tumble_time[cell] - time, this->tumble_speed[cell], this->tumble_end[cell] - time);
+}
+int Population::get_history_size() const
+{
+    return this->history_size;
+}
+SnapshotView Population::get_snapshot(int slot) const
+{
+    return SnapshotView{slot, this->instance.data() + slot % this->history_size * this->n_cells, this->n_cells};
+}
+std::string Population::state_to_string(int cell, int time_step) const
+{
+    std::stringstream strm;
+    CellInstance instance = this->get_instance(cell, time_step);
+    strm << "time-step: " << time_step << "\n";
+    strm << "center_x: " << instance.coord[0] << "\n";
+    strm << "center_y: " << instance.coord[1] << "\n";
+    strm << "direction: " << instance.direction << "\n";
+    strm << "tumble_countdown: " << instance.tumble_countdown << "\n";
+    strm << "tumble_speed: " << instance.tumble_speed << "\n";
+    strm << "tumble_duration: " << instance.tumble_duration << "\n";
+    return strm.str();
+}
+
+void Population::draw(const SnapshotView &snapshot, Camera *camera) const
+{
+    for (const CellInstance &instance : snapshot)
+    {
+        Vector2D center = (instance.coord - camera->coord) * camera->zoom;
+        double radius = this->parameters.body_radius * camera->zoom;
+        for (int x = (int)(center[0] - radius); x <= (int)(center[0] + radius) + 1; x++)
+            for (int y = (int)(center[1] - radius); y <= (int)(center[1] + radius) + 1; y++)
+                if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT)
+                {
+                    double fading = std::max(1 - (center - Vector2D{(double)x, (double)y}).square() / (radius * radius), 0.);
+                    camera->pixels[y][x][1] = int(camera->pixels[y][x][1] * (1 - fading) + 255 * fading);
+                }
+        center = (this->get_flagella_coord(instance) - camera->coord) * camera->zoom;
+        radius = this->parameters.flagella_radius * camera->zoom;
+        for (int x = (int)(center[0] - radius); x <= (int)(center[0] + radius) + 1; x++)
+            for (int y = (int)(center[1] - radius); y <= (int)(center[1] + radius) + 1; y++)
+                if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT)
+                {
+                    double fading = std::max(1 - (center - Vector2D{(double)x, (double)y}).square() / (radius * radius), 0.);
+                    if (instance.tumble_duration > 0)
+                    {
+                        int color = (int)(127.5 + instance.tumble_speed * 50);
+                        camera->pixels[y][x][1] = int(camera->pixels[y][x][1] * (1 - fading) + color * fading);
+                    }
+                    else
+                    {
+                        int color = (int)(255 * std::max(0., 1 - instance.tumble_countdown / this->parameters.tumble_delay_mean));
+                        camera->pixels[y][x][0] = int(camera->pixels[y][x][0] * (1 - fading) + (255 - color) * fading);
+                        camera->pixels[y][x][2] = int(camera->pixels[y][x][2] * (1 - fading) + color * fading);
+                    }
+                }
+    }
+}
+
+// the random numbers only depend on the key and on counters, they have no state to save
+void Population::save_state(CheckpointWriter &out) const
+{
+    for (const std::vector<double> *field : {&this->x, &this->y, &this->direction, &this->tumble_time, &this->tumble_end, &this->tumble_speed})
+        out.write(*field);
+    out.write(this->tumble_count);
+    out.write(this->instance);
+}
+
+void Population::load_state(CheckpointReader &in)
+{
+    for (std::vector<double> *field : {&this->x, &this->y, &this->direction, &this->tumble_time, &this->tumble_end, &this->tumble_speed})
+    {
+        in.read(field);
+        if ((int)field->size() != this->n_cells)
+            throw std::string("The checkpoint does not have the cells of the input file");
+    }
+    in.read(&this->tumble_count);
+    if ((int)this->tumble_count.size() != this->n_cells)
+        throw std::string("The checkpoint does not have the cells of the input file");
+    in.read(&this->instance);
+    if ((int)this->instance.size() != this->history_size * this->n_cells)
+        throw std::string("The checkpoint does not have the saved states of the simulation parameters");
+}
@@ -0,0 +1,175 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "definition.hpp"
+#include "brownianBridge.hpp"
+#include "counterRng.hpp"
+#include "checkpoint.hpp"
+#include "integrator.hpp"
+#include "stepPool.hpp"
+
+struct CellInstance
+{
+    Vector2D coord;
+    double direction;
+    double tumble_countdown;
+    double tumble_speed;
+    double tumble_duration;
+
+    CellInstance(Vector2D coord = {0., 0.}, double direction = 0., double tumble_countdown = 0., double tumble_speed = 0., double tumble_duration = 0.)
+        : coord(coord), direction(direction), tumble_countdown(tumble_countdown), tumble_speed(tumble_speed), tumble_duration(tumble_duration)
+    {
+    }
+};
+
+// read-only view of the saved state of every cell at one slot, without copies.
+// It is valid as long as the slot is kept in the history of the Population.
+struct SnapshotView
+{
+    int slot;
+    const CellInstance *instance;
+    int n_cells;
+
+    int size() const
+    {
+        return this->n_cells;
+    }
+    const CellInstance &operator[](int cell) const
+    {
+        return this->instance[cell];
+    }
+    const CellInstance *begin() const
+    {
+        return this->instance;
+    }
+    const CellInstance *end() const
+    {
+        return this->instance + this->n_cells;
+    }
+};
+
+// physics constants shared by every cell of a species
+struct CellParameters
+{
+    double body_radius;
+    double flagella_radius;
+    double body_flagella_distance;
+    double rotation_center;
+
+    double speed;
+    double tumble_delay_mean;
+    double tumble_strength_mean;
+    double tumble_strength_std;
+    double tumble_duration_mean;
+    double tumble_duration_std;
+
+    double diffusivity, _sqrt_diffusivity;
+    double shear_time;
+
+    double _sqrt_noise_torque_strength;
+    double _sqrt_noise_force_strength;
+
+    double _body_body_6, _body_flagella_6, _flagella_flagella_6;
+
+    CellParameters(nlohmann::json physics_parameters);
+};
+
+// tumbles of one cell, scheduled at absolute times
+struct TumbleState
+{
+    double time;  // onset of the next tumble
+    double end;   // end of the last one
+    double speed; // rotation speed of the last one, zero for instantaneous tumbles
+    int count;    // tumbles so far, the counter of their random numbers
+};
+
+enum TumbleModel
+{
+    NO_TUMBLE,
+    INSTANT_TUMBLE,
+    RUNNING_TUMBLE // tumbles that take their time
+};
+
+// state of all the cells stored as one contiguous array per field
+class Population
+{
+    bool throw_errors;
+    CounterRng random_generator;
+    double delta_time_step; // time step k covers [(k - 1) dt, k dt)
+    int step_size;
+    int history_size;
+    int n_cells;
+
+    CellParameters parameters;
+
+    std::vector<double> x, y, direction;
+    std::vector<double> next_x, next_y, next_direction;
+    // the tumbles only change at their events, which are applied once a step is kept, so
+    // they have no next state
+    std::vector<double> tumble_time, tumble_end, tumble_speed;
+    std::vector<int> tumble_count;
+
+    // ring of the last history_size saved slots, n_cells consecutive instances per slot,
+    // written at the end of the slots the simulation asks for. A slot is sent to the sinks
+    // once the next one starts, the whole run is kept only to be visualized.
+    std::vector<CellInstance> instance;
+
+    // per-step scratch buffers
+    std::vector<double> rotation;
+    std::vector<double> noise_x, noise_y, noise_torque, noise_spare;
+
+    // kernels specialized on the cell model, picked once by the constructor
+    int (Population::*compute_range)(int now, double delta_time_step, const StepConstants &constants, const CellForce *force, const BrownianBridge *bridge, int begin, int end);
+    void (Population::*tumble)(int now, double delta_time_step, int begin, int end);
+    void (*rotate)(int n, double rotation_center, const double *direction, const double *rotation, double *next_x, double *next_y, double *next_direction);
+
+  public:
+    Population(nlohmann::json physics_parameters, nlohmann::json initial_conditions, nlohmann::json simulation_parameters, CounterRng random_generator);
+    // with a bridge, the step lasts its next interval and takes the noise of that interval
+    void compute_step(int now, double delta_time_step, const std::vector<CellForce> &force, int *n_errors, StepPool &pool, const BrownianBridge *bridge = nullptr);
+    void update_state(int now, StepPool &pool);
+    // multi-rate steps, the state of the listed cells is changed in place: one time step of
+    // interacting cells, and one step of n_steps time steps of cells that feel no force
+    void compute_cells_step(const std::vector<int> &cells, int now, double delta_time_step, const std::vector<CellForce> &force, int *n_errors);
+    void compute_free_step(const std::vector<int> &cells, int now, int n_steps, double delta_time_step, StepPool &pool);
+    // copies the state of every cell to the saved slot of time step now, the last of the slot
+    void write_snapshot(int now, StepPool &pool);
+    // true if no tumble of the cell starts or ends in the n_steps time steps from now
+    bool has_steady_tumble(int cell, int now, int n_steps) const;
+    // bound of the distance a point of the cell moves in the n_steps time steps from now without forces
+    double get_move_bound(int cell, int now, int n_steps) const;
+    // largest distance a point of a cell moves between its state and the one computed by compute_step
+    double get_max_displacement(StepPool &pool) const;
+    int size() const;
+    const CellParameters &get_parameters() const;
+    Vector2D get_coord(int cell) const;
+    const double *get_x() const;
+    const double *get_y() const;
+    const double *get_direction() const;
+    Vector2D get_flagella_coord(CellInstance instance) const;
+    // current state of the cell
+    CellInstance get_instance(int cell, int time_step) const;
+    int get_history_size() const;
+    SnapshotView get_snapshot(int slot) const;
+    std::string state_to_string(int cell, int time_step) const;
+    void draw(const SnapshotView &snapshot, Camera *camera) const;
+    void save_state(CheckpointWriter &out) const;
+    void load_state(CheckpointReader &in);
+
+  protected:
+    StepConstants _step_constants(double delta_time_step) const;
+    void _check_force(int cell, int now, const CellForce &force, double mobility) const;
+    void _commit(int cell, int last_step);
+    template <bool off_center, TumbleModel tumble_model>
+    int _compute_range(int now, double delta_time_step, const StepConstants &constants, const CellForce *force, const BrownianBridge *bridge, int begin, int end);
+    template <TumbleModel tumble_model>
+    void _tumble(int now, double delta_time_step, int begin, int end);
+    TumbleState _get_tumble(int cell) const;
+    double _advance_tumble(int cell, double begin, double end, TumbleState &state) const;
+    void _apply_tumble(int cell, double end);
+};
+
+#endif
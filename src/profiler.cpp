@@ -0,0 +1,70 @@
+#include "profiler.hpp"
+
+#ifdef useprofiling
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+static std::mutex registry_lock;
+static std::vector<std::unique_ptr<ProfileData>> registry;
+
+ProfileData &profile_data()
+{
+    thread_local ProfileData *data = nullptr;
+    if (!data)
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        registry.push_back(std::unique_ptr<ProfileData>(new ProfileData()));
+        data = registry.back().get();
+    }
+    return *data;
+}
+
+void profile_report(double wall_seconds, const std::string &json_file)
+{
+    const char *phase_name[PROFILE_N_PHASES] = {"pair_forces", "walls", "integration", "state_update", "map_rebuild", "snapshots", "stats", "checkpoint", "output"};
+    const char *counter_name[PROFILE_N_COUNTERS] = {"steps", "cell_steps", "pairs_tested", "pairs_within_cutoff", "clamped_forces", "rejected_steps"};
+    ProfileData total = ProfileData();
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        for (const std::unique_ptr<ProfileData> &data : registry)
+        {
+            for (int phase = 0; phase < PROFILE_N_PHASES; phase++)
+            {
+                total.seconds[phase] += data->seconds[phase];
+                total.calls[phase] += data->calls[phase];
+            }
+            for (int counter = 0; counter < PROFILE_N_COUNTERS; counter++)
+                total.count[counter] += data->count[counter];
+        }
+    }
+
+    nlohmann::json report;
+    report["wall_seconds"] = wall_seconds;
+    std::cout << "Profile (thread-seconds, wall time " << wall_seconds << " s):\n";
+    for (int phase = 0; phase < PROFILE_N_PHASES; phase++)
+    {
+        double per_cell_step = total.count[PROFILE_CELL_STEPS] > 0 ? total.seconds[phase] * 1e9 / total.count[PROFILE_CELL_STEPS] : 0.;
+        std::cout << "\t" << std::left << std::setw(14) << phase_name[phase] << std::setw(12) << total.seconds[phase] << std::setw(10) << total.calls[phase] << " calls\t" << per_cell_step << " ns/cell-step\n";
+        report["phases"][phase_name[phase]] = {{"seconds", total.seconds[phase]}, {"calls", total.calls[phase]}, {"ns_per_cell_step", per_cell_step}};
+    }
+    for (int counter = 0; counter < PROFILE_N_COUNTERS; counter++)
+    {
+        std::cout << "\t" << std::left << std::setw(20) << counter_name[counter] << total.count[counter] << "\n";
+        report["counters"][counter_name[counter]] = total.count[counter];
+    }
+    if (total.count[PROFILE_PAIRS_TESTED] > 0)
+        std::cout << "\tpairs within the cutoff: " << 100. * total.count[PROFILE_PAIRS_WITHIN_CUTOFF] / total.count[PROFILE_PAIRS_TESTED] << " %\n";
+    std::ofstream out(json_file);
+    out << report.dump(4) << "\n";
+}
+#else
+void profile_report(double wall_seconds, const std::string &json_file)
+{
+}
+#endif
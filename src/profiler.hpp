@@ -0,0 +1,77 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+// Time spent in the phases of the computation and counters of the hot loops, collected when
+// the project is configured with -Dprofiling=true. Each thread accumulates in its own
+// ProfileData, the report sums them, so the times of the phases computed by several threads
+// are thread-seconds. Without profiling the macros compile to nothing.
+enum ProfilePhase
+{
+    PROFILE_PAIR_FORCES,
+    PROFILE_WALLS,
+    PROFILE_INTEGRATION,
+    PROFILE_STATE_UPDATE,
+    PROFILE_MAP_REBUILD,
+    PROFILE_SNAPSHOTS, // analyzers and trajectory buffers receiving the saved states
+    PROFILE_STATS,
+    PROFILE_CHECKPOINT,
+    PROFILE_OUTPUT, // tasks of the writer thread: formatting, compression, files
+    PROFILE_N_PHASES
+};
+
+enum ProfileCounter
+{
+    PROFILE_STEPS,
+    PROFILE_CELL_STEPS,
+    PROFILE_PAIRS_TESTED,
+    PROFILE_PAIRS_WITHIN_CUTOFF,
+    PROFILE_CLAMPED_FORCES,
+    PROFILE_REJECTED_STEPS, // adaptive steps computed again in halves
+    PROFILE_N_COUNTERS
+};
+
+#ifdef useprofiling
+#include <chrono>
+
+struct ProfileData
+{
+    double seconds[PROFILE_N_PHASES];
+    long calls[PROFILE_N_PHASES];
+    long count[PROFILE_N_COUNTERS];
+};
+
+// data of the calling thread, kept after the thread ends
+ProfileData &profile_data();
+
+class ProfileScope
+{
+    ProfilePhase phase;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    ProfileScope(ProfilePhase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope()
+    {
+        ProfileData &data = profile_data();
+        data.seconds[this->phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+        data.calls[this->phase]++;
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// times the rest of the enclosing scope
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#define PROFILE_COUNT(counter, n) (profile_data().count[counter] += (n))
+#else
+#define PROFILE_SCOPE(phase)
+#define PROFILE_COUNT(counter, n)
+#endif
+
+// prints the phases and counters summed over the threads and writes them to json_file,
+// does nothing without profiling
+void profile_report(double wall_seconds, const std::string &json_file);
+
+#endif
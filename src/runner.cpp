@@ -0,0 +1,372 @@
+#include "runner.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "visualization.hpp"
+
+// the value as str() prints it in initializer.py, which builds the same names
+static std::string python_str(const nlohmann::json &value)
+{
+    if (value.is_string())
+        return value.get<std::string>();
+    if (value.is_boolean())
+        return value.get<bool>() ? "True" : "False";
+    if (value.is_null())
+        return "None";
+    return value.dump();
+}
+
+static void add_variations(const nlohmann::json &tree, const nlohmann::json &reference, const nlohmann::json::json_pointer &path, nlohmann::json head, std::vector<RunPoint> *point)
+{
+    if (tree.is_object())
+        for (auto &element : tree.items())
+            add_variations(element.value(), reference, path / element.key(), head, point);
+    else if (tree.is_array())
+        for (unsigned int i = 1; i < tree.size(); i++)
+        {
+            RunPoint variation;
+            std::stringstream strm;
+            strm << tree[0].get<std::string>() << " = " << python_str(tree[i]) << " * ";
+            variation.name = strm.str();
+            variation.sweep = true;
+            variation.physics_parameters = head;
+            variation.physics_parameters["parameters"] = reference;
+            variation.physics_parameters["parameters"][path] = tree[i];
+            point->push_back(variation);
+        }
+}
+
+std::vector<RunPoint> expand_sweep(nlohmann::json sweep_template, nlohmann::json reference)
+{
+    nlohmann::json head;
+    head["unitOfMeasure"] = sweep_template["unitOfMeasure"];
+    head["initialConditions"] = expand_initial_conditions(sweep_template["initialConditions"]);
+    std::vector<RunPoint> point;
+    add_variations(sweep_template["parameters"], reference["parameters"], nlohmann::json::json_pointer(), head, &point);
+    if (point.empty())
+        throw std::string("The sweep template does not contain any [\"label\", values...] list");
+    return point;
+}
+
+nlohmann::json expand_initial_conditions(nlohmann::json initial_conditions)
+{
+    for (auto &kind : initial_conditions.items())
+    {
+        nlohmann::json expanded = nlohmann::json::array();
+        nlohmann::json grid_cells = nlohmann::json::array();
+        for (auto &element : kind.value())
+        {
+            if (!element.contains("grid"))
+            {
+                expanded.push_back(element);
+                continue;
+            }
+            nlohmann::json grid = element["grid"];
+            int rows = grid["rows"].get<int>();
+            int columns = grid["columns"].get<int>();
+            double space = grid["separation"].get<double>();
+            for (int x = 0; x < columns; x++)
+                for (int y = 0; y < rows; y++)
+                {
+                    nlohmann::json cell;
+                    cell["direction"] = grid["direction"];
+                    cell["position"]["x"] = grid["position"]["x"].get<double>() + (x - (columns - 1) / 2.) * space;
+                    cell["position"]["y"] = grid["position"]["y"].get<double>() + (y - (rows - 1) / 2.) * space;
+                    grid_cells.push_back(cell);
+                }
+        }
+        for (auto &cell : grid_cells)
+            expanded.push_back(cell);
+        kind.value() = expanded;
+    }
+    return initial_conditions;
+}
+
+Runner::Runner(nlohmann::json simulation_parameters, std::vector<RunPoint> point, bool resume)
+    : scheduler(simulation_parameters["n_threads"].get<int>(), simulation_parameters["pin_threads"].get<bool>() ? simulation_parameters["n_step_threads"].get<int>() : 0)
+{
+    this->simulation_parameters = simulation_parameters;
+    this->point = point;
+    this->n_simulations = simulation_parameters["n_simulations"].get<int>();
+    this->batch_size = std::max(1, simulation_parameters["replicate_batch_size"].get<int>());
+    if (this->batch_size > 1 && this->point[0].physics_parameters["initialConditions"]["cell"].size() != 1)
+    {
+        std::cout << "WARNING: replicate_batch_size is ignored, the replicates have more than one cell\n";
+        this->batch_size = 1;
+    }
+    this->batch_size = std::min(this->batch_size, std::max(this->n_simulations, 1));
+    this->n_batches = (this->n_simulations + this->batch_size - 1) / this->batch_size;
+    this->batch_parameters = simulation_parameters;
+    // the cells of a batch are replicates, the Map is what finds the pairs
+    if (this->batch_size > 1)
+        this->batch_parameters["map_cell_size"] = 0.;
+    this->slice_size = simulation_parameters["time_slice_size"].get<int>();
+    this->resume = resume;
+    this->checkpoint_interval = simulation_parameters["checkpoint_interval"].get<double>();
+    this->checkpoint_directory = "output/checkpoint/";
+    this->job.resize(this->n_batches * this->point.size());
+    for (Job &job : this->job)
+        job.done = false;
+    this->point_analyzer.resize(this->point.size());
+    this->n_merged = std::vector<int>(this->point.size(), 0);
+    this->merged = std::vector<std::vector<char>>(this->point.size(), std::vector<char>(this->n_batches, 0));
+    this->n_point_errors = std::vector<int>(this->point.size(), 0);
+    this->n_errors = 0;
+}
+
+int Runner::run()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (this->resume)
+        this->_load_checkpoints();
+    else if (this->checkpoint_interval > 0)
+        this->_open_checkpoints();
+    this->scheduler.run(this->job.size(), [this](int job_index, int worker) { return this->_run_slice(job_index, worker); });
+    this->output_writer.wait();
+    // the run is complete, nothing to resume
+    if (this->resume || this->checkpoint_interval > 0)
+        std::filesystem::remove_all(this->checkpoint_directory);
+    profile_report(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), "output/profile.json");
+    return this->n_errors;
+}
+
+bool Runner::_run_slice(int job_index, int worker)
+{
+    Job &job = this->job[job_index];
+    if (job.done)
+        return true;
+    if (!job.world)
+        this->_start(job_index, worker);
+    // a stolen job moves its step threads to the cpus of the thief
+    job.world->pin_step_threads(this->scheduler.get_cpus(worker));
+    bool done = true;
+    try
+    {
+        done = job.world->compute_time_slice(this->slice_size);
+    }
+    catch (std::string error)
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::cout << "ERROR: " << error << "\n";
+    }
+    if (done)
+        this->_finish(job_index);
+    else if (this->checkpoint_interval > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - job.last_checkpoint).count() >= this->checkpoint_interval)
+        this->_save_job(job_index);
+    return done;
+}
+
+int Runner::_get_n_replicates(int batch) const
+{
+    return std::min(this->batch_size, this->n_simulations - batch * this->batch_size);
+}
+
+void Runner::_start(int job_index, int worker)
+{
+    Job &job = this->job[job_index];
+    int point = job_index / this->n_batches;
+    int batch = job_index % this->n_batches;
+    int index = batch * this->batch_size; // first replicate of the batch
+    int n_replicates = this->_get_n_replicates(batch);
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::cout << "\tSimulation n " << index + 1;
+        if (n_replicates > 1)
+            std::cout << " to " << index + n_replicates;
+        if (this->point.size() > 1)
+            std::cout << " of " << this->point[point].name;
+        std::cout << " (thread " << worker << ")...\n";
+    }
+    const nlohmann::json &physics_parameters = this->point[point].physics_parameters;
+    // the replicates of a batch are its cells, each one draws its own random numbers
+    nlohmann::json initial_conditions = physics_parameters["initialConditions"];
+    if (this->batch_size > 1)
+        initial_conditions["cell"] = std::vector<nlohmann::json>(n_replicates, physics_parameters["initialConditions"]["cell"][0]);
+    CounterRng random_generator(this->simulation_parameters["random_seed"].get<int>(), index);
+    job.world.reset(new Simulation(physics_parameters["parameters"], initial_conditions, this->batch_parameters, random_generator));
+    // the statistics are accumulated while the simulation runs, from the streamed snapshots;
+    // the analyzer follows the simulation if it moves to another worker
+    job.analyzer.reset(new Analyzer(this->simulation_parameters, physics_parameters["parameters"]));
+    job.world->add_snapshot_sink(job.analyzer.get());
+    // the trajectories are saved for the first simulation (or batch) of each point only
+    if (this->simulation_parameters["save_trajectory"].get<bool>() && batch == 0)
+    {
+        job.trajectory_writer.reset(new TrajectoryWriter(this->simulation_parameters, this->point[point].sweep ? "output/" + this->point[point].name + "_" : "output/", &this->output_writer));
+        job.world->add_snapshot_sink(job.trajectory_writer.get());
+    }
+    job.last_checkpoint = std::chrono::steady_clock::now();
+}
+
+void Runner::_finish(int job_index)
+{
+    Job &job = this->job[job_index];
+    int point = job_index / this->n_batches;
+    job.trajectory_writer.reset();
+    if (this->simulation_parameters["visualization"].get<bool>())
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::cout << "\tVisualization...\n";
+#ifdef usesdl
+        Visualization visualization;
+        visualization.render(job.world.get(), 0, this->simulation_parameters["n_time_steps"].get<int>(), this->simulation_parameters["saved_time_step_size"].get<int>());
+#else
+        std::cout << "ERROR: compiled without SDL2\n";
+#endif
+    }
+    int n_errors = job.world->get_n_errors();
+    job.world.reset();
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->point_analyzer[point])
+            this->point_analyzer[point]->merge(*job.analyzer);
+        else
+            this->point_analyzer[point] = std::move(job.analyzer);
+        job.analyzer.reset();
+        this->n_merged[point]++;
+        this->merged[point][job_index % this->n_batches] = 1;
+        this->n_point_errors[point] += n_errors;
+        this->n_errors += n_errors;
+        done = this->n_merged[point] == this->n_batches;
+        if (this->checkpoint_interval > 0)
+        {
+            // the point holds the replicate from now on, its own checkpoint is obsolete
+            std::shared_ptr<CheckpointWriter> state = std::make_shared<CheckpointWriter>();
+            state->write(this->n_merged[point]);
+            state->write(this->n_point_errors[point]);
+            state->write(this->merged[point]);
+            this->point_analyzer[point]->save_state(*state);
+            std::string point_file = this->_point_file(point);
+            std::string job_file = this->_job_file(job_index);
+            this->output_writer.submit([state, point_file, job_file]() {
+                state->save(point_file);
+                std::remove(job_file.c_str());
+            });
+        }
+    }
+    // no other thread uses the analyzer of a finished point
+    if (done)
+        this->_save_point(point);
+}
+
+void Runner::_save_point(int point)
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->point.size() > 1)
+            std::cout << "Point " << this->point[point].name << ":\n";
+        std::cout << "Total number of simulation errors: " << this->n_point_errors[point] << "\n";
+        std::cout << "Computing stats...\n";
+    }
+    this->point_analyzer[point]->compute_stats();
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::cout << "Saving stats...\n";
+    }
+    // the files are formatted and written by the writer thread, which then frees the analyzer
+    std::shared_ptr<Analyzer> analyzer(std::move(this->point_analyzer[point]));
+    std::string file_name = "output/" + this->point[point].name;
+    this->output_writer.submit([analyzer, file_name]() { analyzer->save_stats(file_name); });
+}
+
+// what a checkpoint must have been made with to be resumed
+nlohmann::json Runner::_run_description() const
+{
+    nlohmann::json description;
+    description["checkpoint_version"] = 1;
+    description["simulation_parameters"] = this->simulation_parameters;
+    // the settings that do not change the results can differ
+    for (const char *key : {"n_threads", "n_step_threads", "pin_threads", "time_slice", "time_slice_size", "checkpoint_interval", "visualization"})
+        description["simulation_parameters"].erase(key);
+    for (const RunPoint &run_point : this->point)
+        description["points"].push_back({{"name", run_point.name}, {"physics_parameters", run_point.physics_parameters}});
+    return description;
+}
+
+void Runner::_open_checkpoints()
+{
+    std::filesystem::remove_all(this->checkpoint_directory);
+    std::filesystem::create_directories(this->checkpoint_directory);
+    std::ofstream out(this->checkpoint_directory + "run.json");
+    out << this->_run_description().dump();
+}
+
+void Runner::_load_checkpoints()
+{
+    std::ifstream input_file(this->checkpoint_directory + "run.json");
+    if (!input_file)
+        throw std::string("There is no checkpoint to resume in " + this->checkpoint_directory);
+    nlohmann::json description;
+    input_file >> description;
+    if (description != this->_run_description())
+        throw std::string("The checkpoint in " + this->checkpoint_directory + " was made with other parameters");
+
+    for (unsigned int point = 0; point < this->point.size(); point++)
+    {
+        if (!std::filesystem::exists(this->_point_file(point)))
+            continue;
+        CheckpointReader in(this->_point_file(point));
+        in.read(&this->n_merged[point]);
+        in.read(&this->n_point_errors[point]);
+        in.read(&this->merged[point]);
+        this->point_analyzer[point].reset(new Analyzer(this->simulation_parameters, this->point[point].physics_parameters["parameters"]));
+        this->point_analyzer[point]->load_state(in);
+        this->n_errors += this->n_point_errors[point];
+        int n_resumed = 0;
+        for (int batch = 0; batch < this->n_batches; batch++)
+        {
+            this->job[point * this->n_batches + batch].done = this->merged[point][batch];
+            n_resumed += this->merged[point][batch] ? this->_get_n_replicates(batch) : 0;
+        }
+        std::cout << "\tResumed " << n_resumed << " simulations";
+        if (this->point.size() > 1)
+            std::cout << " of " << this->point[point].name;
+        std::cout << "\n";
+        // the stats of a complete point may not have been written
+        if (this->n_merged[point] == this->n_batches)
+            this->_save_point(point);
+    }
+    for (unsigned int job_index = 0; job_index < this->job.size(); job_index++)
+    {
+        if (this->job[job_index].done || !std::filesystem::exists(this->_job_file(job_index)))
+            continue;
+        Job &job = this->job[job_index];
+        this->_start(job_index, 0);
+        CheckpointReader in(this->_job_file(job_index));
+        job.world->load_state(in);
+        job.analyzer->load_state(in);
+        if (job.trajectory_writer)
+            job.trajectory_writer->load_state(in);
+    }
+}
+
+void Runner::_save_job(int job_index)
+{
+    PROFILE_SCOPE(PROFILE_CHECKPOINT);
+    Job &job = this->job[job_index];
+    std::shared_ptr<CheckpointWriter> state = std::make_shared<CheckpointWriter>();
+    job.world->save_state(*state);
+    job.analyzer->save_state(*state);
+    if (job.trajectory_writer)
+        job.trajectory_writer->save_state(*state);
+    // written after the trajectory chunks submitted before, which it counts
+    std::string file_name = this->_job_file(job_index);
+    this->output_writer.submit([state, file_name]() { state->save(file_name); });
+    job.last_checkpoint = std::chrono::steady_clock::now();
+}
+
+std::string Runner::_job_file(int job_index) const
+{
+    return this->checkpoint_directory + "simulation_" + std::to_string(job_index) + ".bin";
+}
+
+std::string Runner::_point_file(int point) const
+{
+    return this->checkpoint_directory + "point_" + std::to_string(point) + ".bin";
+}
@@ -0,0 +1,93 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "analyzer.hpp"
+#include "backgroundWriter.hpp"
+#include "jobScheduler.hpp"
+#include "simulation.hpp"
+#include "trajectoryWriter.hpp"
+
+// one set of physics parameters to simulate
+struct RunPoint
+{
+    std::string name;                  // output files are output/<name>_<statistic>.csv
+    nlohmann::json physics_parameters; // with "parameters" and "initialConditions"
+    bool sweep;                        // the trajectory is output/<name>_trajectory.bin too
+};
+
+// Points of a sweep, as generated by initializer.py: every list ["label", v1, v2, ...] in
+// the template parameters gives one point per value, with all the other parameters taken
+// from the reference file.
+std::vector<RunPoint> expand_sweep(nlohmann::json sweep_template, nlohmann::json reference);
+// replaces the "grid" entries of the initial conditions with the cells they describe
+nlohmann::json expand_initial_conditions(nlohmann::json initial_conditions);
+
+// Runs n_simulations replicates of every point. The (point, batch) jobs are computed in
+// time slices by a work-stealing JobScheduler, so a simulation can move to a worker that has
+// nothing left to do. The statistics of a point are saved as soon as all its replicates are done.
+// A batch is one replicate, or with replicate_batch_size and single-cell replicates, up to
+// that many replicates simulated as the cells of one population, where they do not interact.
+// With a checkpoint_interval, output/checkpoint/ holds the state of the run: every started
+// simulation saves itself between two slices when its last checkpoint is older than the
+// interval, and every point saves its merged statistics when a replicate finishes. A run
+// created with resume continues from there and removes the directory once it is done.
+class Runner
+{
+    // state of a started simulation between two of its time slices
+    struct Job
+    {
+        std::unique_ptr<Simulation> world;
+        std::unique_ptr<Analyzer> analyzer;
+        std::unique_ptr<TrajectoryWriter> trajectory_writer;
+        bool done;
+        std::chrono::steady_clock::time_point last_checkpoint;
+    };
+
+    nlohmann::json simulation_parameters;
+    nlohmann::json batch_parameters; // of the simulations of the jobs, without pair forces for batches
+    std::vector<RunPoint> point;
+    int n_simulations;
+    int batch_size; // replicates per job
+    int n_batches;  // jobs per point
+    int slice_size; // time steps of one slice
+    bool resume;
+    double checkpoint_interval; // seconds between two checkpoints of a simulation, 0 for none
+    std::string checkpoint_directory;
+
+    JobScheduler scheduler;
+    BackgroundWriter output_writer; // declared before the jobs, whose writers submit to it
+    std::vector<Job> job; // job j is the batch j % n_batches of the point j / n_batches
+
+    std::mutex lock; // output and statistics of the points
+    std::vector<std::unique_ptr<Analyzer>> point_analyzer;
+    std::vector<int> n_merged; // batches of each point merged in its analyzer
+    std::vector<std::vector<char>> merged;
+    std::vector<int> n_point_errors;
+    int n_errors;
+
+  public:
+    Runner(nlohmann::json simulation_parameters, std::vector<RunPoint> point, bool resume = false);
+    int run();
+
+  protected:
+    bool _run_slice(int job_index, int worker);
+    int _get_n_replicates(int batch) const;
+    void _start(int job_index, int worker);
+    void _finish(int job_index);
+    void _save_point(int point);
+    nlohmann::json _run_description() const;
+    void _open_checkpoints();
+    void _load_checkpoints();
+    void _save_job(int job_index);
+    std::string _job_file(int job_index) const;
+    std::string _point_file(int point) const;
+};
+
+#endif
@@ -1,92 +1,344 @@
 #include "simulation.hpp"
-#include <gsl/gsl_randist.h>
+#include "profiler.hpp"
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 
-Simulation::Simulation(nlohmann::json physics_parameters, nlohmann::json initial_conditions, nlohmann::json simulation_parameters, gsl_rng *random_generator)
+Simulation::Simulation(nlohmann::json physics_parameters, nlohmann::json initial_conditions, nlohmann::json simulation_parameters, CounterRng random_generator)
     : map(physics_parameters["wallTop"]["y"].get<double>(), physics_parameters["wallBottom"]["y"].get<double>(), physics_parameters["wallLeft"]["x"].get<double>(), physics_parameters["wallRight"]["x"].get<double>(), physics_parameters["wallDisk"]["thickness"].get<double>() > 0 || physics_parameters["wallTop"]["thickness"].get<double>() > 0 ? simulation_parameters["map_cell_size"].get<double>() : 0.),
-      wallDisk(physics_parameters["wallDisk"], &map),
-      wallTop(physics_parameters["wallTop"], &map),
-      wallBottom(physics_parameters["wallBottom"], &map),
-      wallLeft(physics_parameters["wallLeft"], &map),
-      wallRight(physics_parameters["wallRight"], &map)
+      population(physics_parameters["cell"], initial_conditions["cell"], simulation_parameters, random_generator),
+      boundary(physics_parameters),
+      pair_force(population.get_parameters()),
+      step_pool(simulation_parameters["n_step_threads"].get<int>()),
+      bridge(random_generator, population.size())
 {
-    isWallDisk = physics_parameters["wallDisk"]["thickness"].get<double>() > 0;
-    isWallTop = physics_parameters["wallTop"]["thickness"].get<double>() > 0;
-
-    for (unsigned int i = 0; i < initial_conditions["cell"].size(); i++)
-        this->cell.push_back(Cell(physics_parameters["cell"], initial_conditions["cell"][i], simulation_parameters, random_generator, &map));
+    this->map.rebuild(this->population.get_x(), this->population.get_y(), this->population.size(), this->step_pool);
 
     this->n_errors = 0;
-    this->random_generator = random_generator;
     this->delta_time_step = simulation_parameters["time_step"].get<double>();
     this->n_time_steps = simulation_parameters["n_time_steps"].get<double>();
     this->step_size = simulation_parameters["saved_time_step_size"].get<int>();
+    this->adaptive_time_step = simulation_parameters["adaptive_time_step"].get<bool>();
+    this->max_step_size = std::max(1, simulation_parameters["max_time_step_size"].get<int>());
+    this->step_tolerance = simulation_parameters["step_tolerance"].get<double>();
+    this->multi_rate = simulation_parameters["multi_rate"].get<bool>();
+    this->multi_rate_skin = simulation_parameters["multi_rate_skin"].get<double>();
 
     this->time_step = 1;
+    this->saved_slot = 0;
+    this->end_slot = (this->n_time_steps - this->step_size) / this->step_size;
+    // the visualization reads the whole history
+    this->demand = simulation_parameters["visualization"].get<bool>() ? SNAPSHOT_STREAM : SNAPSHOT_NONE;
+    this->finished = false;
+}
+
+void Simulation::add_snapshot_sink(SnapshotSink *sink)
+{
+    this->snapshot_sink.push_back(sink);
+    this->demand = std::max(this->demand, sink->get_demand());
 }
 
 int Simulation::compute_simulation()
 {
-    for (; this->time_step < this->n_time_steps; ++this->time_step)
-    {
-        this->compute_next_step();
-        // if (this->time_step % 1000 == 0) ////
-        //     std::cout << (int)this->time_step << "\n";
-    }
+    this->compute_time_slice(this->n_time_steps);
+    return this->n_errors;
+}
+
+// computes at most n_steps time steps, returns true once the simulation is over
+bool Simulation::compute_time_slice(int n_steps)
+{
+    if (this->finished)
+        return true;
+    int end_step = std::min(this->time_step + n_steps, this->n_time_steps);
+    if (this->multi_rate)
+        while (this->time_step < end_step)
+            this->_compute_multi_rate_slot();
+    else if (this->adaptive_time_step)
+        while (this->time_step < end_step)
+            this->_compute_adaptive_step();
+    else
+        for (; this->time_step < end_step; ++this->time_step)
+            this->compute_next_step();
+    if (this->time_step < this->n_time_steps)
+        return false;
+    this->_send_snapshot(this->saved_slot);
+    this->finished = true;
+    return true;
+}
+
+void Simulation::pin_step_threads(const std::vector<int> &cpus)
+{
+    this->step_pool.pin(cpus);
+}
+
+int Simulation::get_n_errors() const
+{
     return this->n_errors;
 }
 
 void Simulation::compute_next_step()
 {
-    std::vector<CellForce> force(this->cell.size(), CellForce{{0., 0.}, {0., 0.}});
-    for (unsigned int i = 0; i < this->cell.size(); i++)
+    PROFILE_COUNT(PROFILE_STEPS, 1);
+    PROFILE_COUNT(PROFILE_CELL_STEPS, this->population.size());
+    std::vector<CellForce> force(this->population.size(), CellForce{{0., 0.}, {0., 0.}});
+    if (this->map.is_mapping())
+        this->pair_force.add_forces(this->population, this->map, force, this->step_pool);
+    this->boundary.add_forces(this->population, force, this->step_pool);
+    try
+    {
+        this->population.compute_step(this->time_step, this->delta_time_step, force, &(this->n_errors), this->step_pool);
+    }
+    catch (std::string error)
+    {
+        std::stringstream strm;
+        strm << "Simulation error at time_step " << this->time_step << ": \n\t";
+        strm << error << "\n";
+        throw strm.str();
+    }
+    this->population.update_state(this->time_step, this->step_pool);
+    this->_write_snapshot(this->time_step);
+    // a slot is complete once the next one starts being written
+    if (this->time_step / this->step_size != this->saved_slot)
+    {
+        this->_send_snapshot(this->saved_slot);
+        this->saved_slot = this->time_step / this->step_size;
+    }
+    this->map.rebuild(this->population.get_x(), this->population.get_y(), this->population.size(), this->step_pool);
+}
+
+// one accepted step of the largest interval of the bridge along which no cell moves more
+// than step_tolerance, down to a single time step, which is always accepted
+void Simulation::_compute_adaptive_step()
+{
+    if (this->bridge.is_empty())
+    {
+        int slot_end = (this->time_step / this->step_size + 1) * this->step_size;
+        this->bridge.start(this->time_step, std::min(slot_end, this->n_time_steps), this->step_pool);
+    }
+    std::vector<CellForce> force(this->population.size(), CellForce{{0., 0.}, {0., 0.}});
+    if (this->map.is_mapping())
+        this->pair_force.add_forces(this->population, this->map, force, this->step_pool);
+    this->boundary.add_forces(this->population, force, this->step_pool);
+
+    // the drift and the forces are known before the step and bound the speed of the body and
+    // of the flagella; below the tolerance the forces are never clamped, so only single time
+    // steps can count errors
+    const CellParameters &p = this->population.get_parameters();
+    double body_lever = std::abs(p.rotation_center);
+    double flagella_lever = std::abs(p.body_flagella_distance - p.rotation_center);
+    double max_force_speed = 0.;
+    for (const CellForce &cell_force : force)
+    {
+        double torque = body_lever * sqrt(cell_force.body.square()) + flagella_lever * sqrt(cell_force.flagella.square());
+        max_force_speed = std::max(max_force_speed, p.diffusivity * sqrt((cell_force.body + cell_force.flagella).square()) + p.body_flagella_distance * torque / p.shear_time);
+    }
+    double max_speed = p.speed + max_force_speed;
+    while (this->bridge.get_size() > 1 && (this->bridge.get_size() > this->max_step_size || max_speed * this->bridge.get_size() * this->delta_time_step > this->step_tolerance))
+        this->bridge.split(this->step_pool);
+    // the noise is only known once drawn: a step moving a cell too far is computed again in
+    // two halves with the same noise
+    while (true)
+    {
+        int n_steps = this->bridge.get_size();
+        try
+        {
+            this->population.compute_step(this->time_step, n_steps * this->delta_time_step, force, &(this->n_errors), this->step_pool, &this->bridge);
+        }
+        catch (std::string error)
+        {
+            std::stringstream strm;
+            strm << "Simulation error at time_step " << this->time_step << ": \n\t";
+            strm << error << "\n";
+            throw strm.str();
+        }
+        if (n_steps == 1 || this->population.get_max_displacement(this->step_pool) <= this->step_tolerance)
+            break;
+        PROFILE_COUNT(PROFILE_REJECTED_STEPS, 1);
+        this->bridge.split(this->step_pool);
+    }
+    PROFILE_COUNT(PROFILE_STEPS, 1);
+    PROFILE_COUNT(PROFILE_CELL_STEPS, this->population.size());
+
+    int last_step = this->time_step + this->bridge.get_size() - 1;
+    this->bridge.pop();
+    this->population.update_state(last_step, this->step_pool);
+    this->_write_snapshot(last_step);
+    if (last_step / this->step_size != this->saved_slot)
+    {
+        this->_send_snapshot(this->saved_slot);
+        this->saved_slot = last_step / this->step_size;
+    }
+    this->map.rebuild(this->population.get_x(), this->population.get_y(), this->population.size(), this->step_pool);
+    this->time_step = last_step + 1;
+}
+
+// The rest of the slot of saved states at once. A cell is free when no tumble starts or ends
+// in the slot and it cannot come within reach of a wall or of another cell, given the
+// distance the cells can move without forces plus the skin. The free cells take one step
+// over the slot, the others take its time steps with the forces of the pairs that can meet.
+void Simulation::_compute_multi_rate_slot()
+{
+    int slot_begin = this->time_step;
+    int slot_end = std::min((slot_begin / this->step_size + 1) * this->step_size, this->n_time_steps);
+    int n_steps = slot_end - slot_begin;
+    int n_cells = this->population.size();
+
+    std::vector<double> margin(n_cells);
+    double max_margin = 0.;
+    for (int i = 0; i < n_cells; i++)
+    {
+        margin[i] = this->population.get_move_bound(i, slot_begin, n_steps) + this->multi_rate_skin;
+        max_margin = std::max(max_margin, margin[i]);
+    }
+    std::vector<bool> is_free(n_cells);
+    int n_active = 0;
+    double wall_reach = Boundary::get_reach(this->population.get_parameters());
+    for (int i = 0; i < n_cells; i++)
     {
-        std::set<Actor *> neighbours = map.check(&(this->cell[i]), this->cell[i].get_instance(this->time_step - 1).coord);
-        for (std::set<Actor *>::iterator it = neighbours.begin(); it != neighbours.end(); ++it)
-            force[i] += (*it)->interaction(&(this->cell[i]), this->time_step - 1);
+        is_free[i] = this->population.has_steady_tumble(i, slot_begin, n_steps) &&
+                     this->boundary.get_wall_distance(this->population.get_coord(i)) > wall_reach + margin[i];
+        n_active += !is_free[i];
     }
-    for (unsigned int i = 0; i < this->cell.size(); i++)
+    // the search stops once the slot is known to be computed as usual
+    std::vector<std::pair<int, int>> pairs;
+    if (this->map.is_mapping())
     {
+        double pair_reach = this->pair_force.get_reach();
+        std::vector<int> candidates;
+        for (int i = 0; i < n_cells && n_active <= n_cells / 2; i++)
+        {
+            Vector2D coord = this->population.get_coord(i);
+            candidates.clear();
+            this->map.get_cells_within(coord, pair_reach + margin[i] + max_margin, &candidates);
+            for (int j : candidates)
+            {
+                double distance = pair_reach + margin[i] + margin[j];
+                if (j > i && (this->population.get_coord(j) - coord).square() < distance * distance)
+                {
+                    pairs.push_back({i, j});
+                    n_active += is_free[i] + is_free[j];
+                    is_free[i] = false;
+                    is_free[j] = false;
+                }
+            }
+        }
+    }
+
+    // a slot of mostly interacting cells is computed as usual
+    if (n_steps == 1 || n_active > n_cells / 2)
+    {
+        if (this->adaptive_time_step)
+            while (this->time_step < slot_end)
+                this->_compute_adaptive_step();
+        else
+            for (; this->time_step < slot_end; ++this->time_step)
+                this->compute_next_step();
+        return;
+    }
+    std::vector<int> free, active;
+    for (int i = 0; i < n_cells; i++)
+        (is_free[i] ? free : active).push_back(i);
+
+    PROFILE_COUNT(PROFILE_STEPS, n_steps);
+    PROFILE_COUNT(PROFILE_CELL_STEPS, (long)active.size() * n_steps + (long)free.size());
+    std::vector<CellForce> force(n_cells, CellForce{{0., 0.}, {0., 0.}});
+    for (; this->time_step < slot_end; ++this->time_step)
+    {
+        for (int i : active)
+            force[i] = CellForce{{0., 0.}, {0., 0.}};
+        this->pair_force.add_pair_forces(this->population, pairs, force);
+        this->boundary.add_forces(this->population, active, force);
         try
         {
-            this->cell[i].compute_step(this->time_step, this->delta_time_step, force[i], &(this->n_errors));
+            this->population.compute_cells_step(active, this->time_step, this->delta_time_step, force, &(this->n_errors));
         }
         catch (std::string error)
         {
             std::stringstream strm;
             strm << "Simulation error at time_step " << this->time_step << ": \n\t";
             strm << error << "\n";
-            strm << "\nCell's previous saved state:\n"
-                 << this->cell[i].state_to_string(this->time_step - 1);
             throw strm.str();
         }
     }
-    for (unsigned int i = 0; i < this->cell.size(); i++)
-        this->cell[i].update_state(this->time_step, &map);
+    this->population.compute_free_step(free, slot_begin, n_steps, this->delta_time_step, this->step_pool);
+
+    int last_step = slot_end - 1;
+    this->_write_snapshot(last_step);
+    if (last_step / this->step_size != this->saved_slot)
+    {
+        this->_send_snapshot(this->saved_slot);
+        this->saved_slot = last_step / this->step_size;
+    }
+    this->map.rebuild(this->population.get_x(), this->population.get_y(), n_cells, this->step_pool);
 }
 
-std::vector<Cell> Simulation::get_cells() const
+bool Simulation::_is_demanded(SnapshotDemand demand, int slot) const
 {
-    return this->cell;
+    return demand == SNAPSHOT_STREAM || (demand == SNAPSHOT_FINAL && slot == this->end_slot);
 }
 
-double Simulation::get_delta_time_step() const
+// saves the state at the last step of a slot, if the slot is read
+void Simulation::_write_snapshot(int step)
 {
-    return this->delta_time_step;
+    if ((step + 1) % this->step_size != 0 && step != this->n_time_steps - 1)
+        return;
+    if (this->_is_demanded(this->demand, step / this->step_size))
+        this->population.write_snapshot(step, this->step_pool);
+}
+
+void Simulation::_send_snapshot(int slot)
+{
+    PROFILE_SCOPE(PROFILE_SNAPSHOTS);
+    for (SnapshotSink *sink : this->snapshot_sink)
+        if (this->_is_demanded(sink->get_demand(), slot))
+            sink->save_snapshot(this->population.get_snapshot(slot));
 }
 
-void Simulation::draw_frame(int time_step, Camera *camera) const
+// last slot of saved states written so far
+int Simulation::get_saved_slot() const
 {
-    if (isWallDisk)
-        wallDisk.draw(time_step, camera);
-    if (isWallTop)
+    return this->saved_slot;
+}
+
+SnapshotView Simulation::get_snapshot(int slot) const
+{
+    if (slot < 0 || slot > this->saved_slot || slot <= this->saved_slot - this->population.get_history_size())
     {
-        wallTop.draw(time_step, camera);
-        wallBottom.draw(time_step, camera);
-        wallLeft.draw(time_step, camera);
-        wallRight.draw(time_step, camera);
+        std::stringstream strm;
+        strm << "Saved state " << slot << " is not in the history, which holds the last " << this->population.get_history_size() << " slots up to " << this->saved_slot;
+        throw strm.str();
     }
-    for (unsigned int i = 0; i < this->cell.size(); i++)
-        this->cell[i].draw(time_step, camera);
+    return this->population.get_snapshot(slot);
+}
+
+double Simulation::get_delta_time_step() const
+{
+    return this->delta_time_step;
+}
+
+void Simulation::draw_frame(const SnapshotView &snapshot, Camera *camera) const
+{
+    this->boundary.draw(snapshot.slot * this->step_size, camera);
+    this->population.draw(snapshot, camera);
+}
+
+void Simulation::save_state(CheckpointWriter &out) const
+{
+    out.write(this->time_step);
+    out.write(this->saved_slot);
+    out.write(this->n_errors);
+    out.write(this->finished);
+    this->population.save_state(out);
+    this->bridge.save_state(out);
+}
+
+void Simulation::load_state(CheckpointReader &in)
+{
+    in.read(&this->time_step);
+    in.read(&this->saved_slot);
+    in.read(&this->n_errors);
+    in.read(&this->finished);
+    this->population.load_state(in);
+    this->bridge.load_state(in);
+    this->map.rebuild(this->population.get_x(), this->population.get_y(), this->population.size(), this->step_pool);
 }
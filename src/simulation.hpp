@@ -1,45 +1,74 @@
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
-#include <gsl/gsl_rng.h>
 #include "nlohmann/json.hpp"
 #include "definition.hpp"
-#include "wallDisk.hpp"
-#include "wallTop.hpp"
-#include "wallBottom.hpp"
-#include "wallLeft.hpp"
-#include "wallRight.hpp"
-#include "cell.hpp"
+#include "boundary.hpp"
+#include "population.hpp"
+#include "brownianBridge.hpp"
+#include "pairForce.hpp"
 #include "map.hpp"
+#include "stepPool.hpp"
+#include "snapshotSink.hpp"
 
 class Simulation
 {
     int n_errors;
-    gsl_rng *random_generator;
 
     double delta_time_step;
     int n_time_steps;
     int time_step;
     int step_size;
+    int saved_slot; // slot of the saved states being written
+    int end_slot;   // last complete slot
+    SnapshotDemand demand; // of all the sinks, and of the visualization
+    bool finished;
+
+    // adaptive steps last up to max_step_size time steps, as long as no cell moves more than
+    // step_tolerance micrometers; they never cross the end of a slot of saved states
+    bool adaptive_time_step;
+    int max_step_size;
+    double step_tolerance;
+
+    // multi-rate slots: the cells that cannot feel a force before the end of a slot take a
+    // single step over it, the others take the time steps; skin (micrometers) is added to the
+    // distances the cells can move, for the forces pushing them
+    bool multi_rate;
+    double multi_rate_skin;
 
     Map map;
 
-    std::vector<Cell> cell;
-    bool isWallDisk;
-    WallDisk wallDisk;
-    bool isWallTop;
-    WallTop wallTop;
-    WallBottom wallBottom;
-    WallLeft wallLeft;
-    WallRight wallRight;
+    Population population;
+    Boundary boundary;
+    PairForce pair_force;
+
+    StepPool step_pool; // threads computing the phases of one step
+    BrownianBridge bridge; // noise of the adaptive steps
+
+    std::vector<SnapshotSink *> snapshot_sink;
 
 public:
-    Simulation(nlohmann::json physics_parameters, nlohmann::json initial_conditions, nlohmann::json simulation_parameters, gsl_rng *random_generator);
+    Simulation(nlohmann::json physics_parameters, nlohmann::json initial_conditions, nlohmann::json simulation_parameters, CounterRng random_generator);
+    void add_snapshot_sink(SnapshotSink *sink);
     void compute_next_step();
     int compute_simulation();
+    bool compute_time_slice(int n_steps);
+    // binds the step threads to the cpus of the worker running the next slice
+    void pin_step_threads(const std::vector<int> &cpus);
+    int get_n_errors() const;
     double get_delta_time_step() const;
-    std::vector<Cell> get_cells() const;
-    void draw_frame(int time_step, Camera *camera) const;
+    int get_saved_slot() const;
+    SnapshotView get_snapshot(int slot) const;
+    void draw_frame(const SnapshotView &snapshot, Camera *camera) const;
+    void save_state(CheckpointWriter &out) const;
+    void load_state(CheckpointReader &in);
+
+protected:
+    void _compute_adaptive_step();
+    void _compute_multi_rate_slot();
+    bool _is_demanded(SnapshotDemand demand, int slot) const;
+    void _write_snapshot(int step);
+    void _send_snapshot(int slot);
 };
 
 #endif
\ No newline at end of file
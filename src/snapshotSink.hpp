@@ -0,0 +1,26 @@
+#ifndef SNAPSHOT_SINK_H
+#define SNAPSHOT_SINK_H
+
+#include "population.hpp"
+
+// saved states a sink consumes; the simulation only copies the slots some sink needs
+enum SnapshotDemand
+{
+    SNAPSHOT_NONE,
+    SNAPSHOT_FINAL, // the last complete slot
+    SNAPSHOT_STREAM // every slot
+};
+
+// Receives the saved states of a simulation while it runs, in increasing slot order.
+// Slot k is the state of every cell at time step (k + 1) * saved_time_step_size - 1;
+// the view is only valid during the call.
+class SnapshotSink
+{
+  public:
+    // constant for the life of the sink
+    virtual SnapshotDemand get_demand() const = 0;
+    virtual void save_snapshot(const SnapshotView &snapshot) = 0;
+    virtual ~SnapshotSink() {}
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "stepPool.hpp"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+StepPool::StepPool(int n_threads)
+{
+    this->n_threads = std::max(n_threads, 1);
+    this->generation = 0;
+    this->stop = false;
+    this->n_running = 0;
+    this->task = nullptr;
+    this->n_tasks = 0;
+    this->next_task = 0;
+    for (int i = 1; i < this->n_threads; i++)
+        this->worker.push_back(std::thread(&StepPool::_work, this));
+}
+
+StepPool::~StepPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stop = true;
+    }
+    this->start.notify_all();
+    for (std::thread &thread : this->worker)
+        thread.join();
+}
+
+int StepPool::size() const
+{
+    return this->n_threads;
+}
+
+void StepPool::run(int n_tasks, const std::function<void(int)> &task)
+{
+    if (n_tasks <= 0)
+        return;
+    if (this->n_threads == 1 || n_tasks == 1)
+    {
+        for (int i = 0; i < n_tasks; i++)
+            task(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->task = &task;
+        this->n_tasks = n_tasks;
+        this->next_task = 0;
+        this->error = nullptr;
+        this->n_running = this->n_threads - 1;
+        this->generation++;
+    }
+    this->start.notify_all();
+    this->_take_tasks();
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->done.wait(guard, [this] { return this->n_running == 0; });
+    this->task = nullptr;
+    if (this->error)
+        std::rethrow_exception(this->error);
+}
+
+void StepPool::run_range(int n, const std::function<void(int, int)> &task)
+{
+    int n_chunks = std::min(this->n_threads, n);
+    this->run(n_chunks, [&](int chunk) { task((long)n * chunk / n_chunks, (long)n * (chunk + 1) / n_chunks); });
+}
+
+void StepPool::pin(const std::vector<int> &cpus)
+{
+    if (cpus.empty() || cpus == this->cpus)
+        return;
+    this->cpus = cpus;
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &cpu_set);
+    for (std::thread &thread : this->worker)
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+void StepPool::_work()
+{
+    int seen_generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->start.wait(guard, [&] { return this->stop || this->generation != seen_generation; });
+            if (this->stop)
+                return;
+            seen_generation = this->generation;
+        }
+        this->_take_tasks();
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->n_running--;
+        }
+        this->done.notify_one();
+    }
+}
+
+void StepPool::_take_tasks()
+{
+    for (int i = this->next_task++; i < this->n_tasks; i = this->next_task++)
+    {
+        try
+        {
+            (*this->task)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (!this->error)
+                this->error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef STEP_POOL_H
+#define STEP_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads shared by the phases of one simulation step.
+// run() hands the tasks [0, n_tasks) to the workers and to the calling thread and returns
+// when all of them are done. Which thread computes a task is not fixed, so tasks must write
+// disjoint data for the result not to depend on the number of threads.
+class StepPool
+{
+    int n_threads;
+    std::vector<std::thread> worker;
+
+    std::mutex lock;
+    std::condition_variable start, done;
+    int generation;
+    bool stop;
+    int n_running;
+
+    const std::function<void(int)> *task;
+    int n_tasks;
+    std::atomic<int> next_task;
+    std::exception_ptr error;
+    std::vector<int> cpus; // of the worker threads, empty while they are not pinned
+
+  public:
+    StepPool(int n_threads);
+    ~StepPool();
+    StepPool(const StepPool &) = delete;
+    StepPool &operator=(const StepPool &) = delete;
+
+    int size() const;
+    void run(int n_tasks, const std::function<void(int)> &task);
+    // splits [0, n) in at most one contiguous range per thread
+    void run_range(int n, const std::function<void(int, int)> &task);
+    // binds the worker threads to the cpus, if they are not already; nothing if empty
+    void pin(const std::vector<int> &cpus);
+
+  protected:
+    void _work();
+    void _take_tasks();
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "trajectoryWriter.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+#ifdef usezlib
+#include <zlib.h>
+#endif
+
+TrajectoryWriter::TrajectoryWriter(nlohmann::json simulation_parameters, const std::string &prefix, BackgroundWriter *writer)
+{
+    this->file_name = prefix + "trajectory.bin";
+    this->time_step_size = simulation_parameters["time_step"].get<double>();
+    this->step_size = simulation_parameters["saved_time_step_size"].get<int>();
+    this->compress = simulation_parameters["trajectory_compression"].get<std::string>() == "zlib";
+#ifndef usezlib
+    if (this->compress)
+        std::cout << "WARNING: compiled without zlib, the trajectories are not compressed\n";
+    this->compress = false;
+#endif
+    this->writer = writer;
+    this->n_cells = 0;
+    this->chunk_size = 0;
+    this->n_buffered = 0;
+    this->started = false;
+    this->n_chunks = 0;
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    this->flush();
+}
+
+void TrajectoryWriter::_start(int n_cells)
+{
+    this->n_cells = n_cells;
+    // chunks of about 8 MB
+    this->chunk_size = std::min(4096, std::max(16, 8000000 / (n_cells * 25 + 8)));
+    this->time.assign(this->chunk_size, 0.);
+    for (std::vector<double> *column : {&this->x, &this->y, &this->direction})
+        column->assign(this->chunk_size * n_cells, 0.);
+    this->tumbling.assign(this->chunk_size * n_cells, 0);
+}
+
+SnapshotDemand TrajectoryWriter::get_demand() const
+{
+    return SNAPSHOT_STREAM;
+}
+
+void TrajectoryWriter::save_snapshot(const SnapshotView &snapshot)
+{
+    if (this->chunk_size == 0)
+        this->_start(snapshot.size());
+    int row = this->n_buffered * this->n_cells;
+    this->time[this->n_buffered] = this->time_step_size * ((snapshot.slot + 1) * this->step_size - 1);
+    for (int i = 0; i < this->n_cells; i++)
+    {
+        const CellInstance &instance = snapshot[i];
+        this->x[row + i] = instance.coord[0];
+        this->y[row + i] = instance.coord[1];
+        this->direction[row + i] = instance.direction;
+        this->tumbling[row + i] = instance.tumble_speed != 0. && instance.tumble_duration > 0.;
+    }
+    this->n_buffered++;
+    if (this->n_buffered == this->chunk_size)
+        this->flush();
+}
+
+std::string TrajectoryWriter::_header() const
+{
+    nlohmann::json header;
+    header["version"] = 1;
+    header["n_cells"] = this->n_cells;
+    header["chunk_size"] = this->chunk_size;
+    header["saved_time_step"] = this->time_step_size * this->step_size;
+    header["compression"] = this->compress ? "zlib" : "none";
+    header["columns"] = nlohmann::json::array();
+    header["columns"].push_back({{"name", "time"}, {"type", "<f8"}, {"per", "snapshot"}});
+    for (const char *name : {"x", "y", "direction"})
+        header["columns"].push_back({{"name", name}, {"type", "<f8"}, {"per", "cell"}});
+    header["columns"].push_back({{"name", "tumbling"}, {"type", "|u1"}, {"per", "cell"}});
+    std::string text = header.dump();
+    text.resize((text.size() + 7) / 8 * 8, ' ');
+    return text;
+}
+
+void TrajectoryWriter::flush()
+{
+    if (this->n_buffered == 0)
+        return;
+    // the whole chunk is written even if partly filled, so that all the chunks have the same size
+    long n_values = (long)this->chunk_size * this->n_cells;
+    long payload_size = ((this->chunk_size + 3 * n_values) * sizeof(double) + n_values + 7) / 8 * 8;
+    std::shared_ptr<std::vector<char>> payload(new std::vector<char>(payload_size, 0));
+    char *position = payload->data();
+    std::memcpy(position, this->time.data(), this->chunk_size * sizeof(double));
+    position += this->chunk_size * sizeof(double);
+    for (std::vector<double> *column : {&this->x, &this->y, &this->direction})
+    {
+        std::memcpy(position, column->data(), n_values * sizeof(double));
+        position += n_values * sizeof(double);
+    }
+    std::memcpy(position, this->tumbling.data(), n_values);
+
+    std::string header = this->started ? "" : this->_header();
+    uint64_t n_snapshots = this->n_buffered;
+    std::string file_name = this->file_name;
+    bool compress = this->compress;
+    this->writer->submit([payload, header, n_snapshots, file_name, compress]() {
+        const std::vector<char> *data = payload.get();
+#ifdef usezlib
+        std::vector<char> compressed;
+        if (compress)
+        {
+            uLongf size = compressBound(payload->size());
+            compressed.resize(size);
+            if (compress2((Bytef *)compressed.data(), &size, (const Bytef *)payload->data(), payload->size(), Z_BEST_SPEED) != Z_OK)
+                throw std::string("Cannot compress the trajectory chunk of " + file_name);
+            compressed.resize(size);
+            data = &compressed;
+        }
+#endif
+        // the first chunk replaces the file of a previous run
+        std::ofstream out(file_name, std::ios::binary | (header.empty() ? std::ios::app : std::ios::trunc));
+        if (!out)
+            throw std::string("Cannot open " + file_name);
+        if (!header.empty())
+        {
+            uint64_t header_size = header.size();
+            out.write("SWTRAJ1\n", 8);
+            out.write((const char *)&header_size, sizeof(header_size));
+            out.write(header.data(), header.size());
+        }
+        uint64_t chunk_head[2] = {n_snapshots, data->size()};
+        out.write((const char *)chunk_head, sizeof(chunk_head));
+        out.write(data->data(), data->size());
+    });
+    this->started = true;
+    this->n_chunks++;
+    this->n_buffered = 0;
+}
+
+void TrajectoryWriter::save_state(CheckpointWriter &out) const
+{
+    out.write(this->started);
+    out.write(this->n_chunks);
+    out.write(this->n_cells);
+    out.write(this->chunk_size);
+    out.write(this->n_buffered);
+    for (const std::vector<double> *column : {&this->time, &this->x, &this->y, &this->direction})
+        out.write(*column);
+    out.write(this->tumbling);
+}
+
+void TrajectoryWriter::load_state(CheckpointReader &in)
+{
+    in.read(&this->started);
+    in.read(&this->n_chunks);
+    in.read(&this->n_cells);
+    in.read(&this->chunk_size);
+    in.read(&this->n_buffered);
+    for (std::vector<double> *column : {&this->time, &this->x, &this->y, &this->direction})
+        in.read(column);
+    in.read(&this->tumbling);
+    if (!this->started)
+        return;
+    // the chunks written after the checkpoint are computed again
+    std::ifstream file(this->file_name, std::ios::binary);
+    uint64_t size;
+    file.seekg(8);
+    file.read((char *)&size, sizeof(size));
+    long end = 16 + size;
+    for (int i = 0; i < this->n_chunks && file; i++)
+    {
+        uint64_t chunk_head[2];
+        file.seekg(end);
+        file.read((char *)chunk_head, sizeof(chunk_head));
+        end += sizeof(chunk_head) + chunk_head[1];
+    }
+    if (!file)
+        throw std::string("The trajectory file " + this->file_name + " is shorter than its checkpoint");
+    file.close();
+    if (truncate(this->file_name.c_str(), end) != 0)
+        throw std::string("Cannot cut " + this->file_name);
+}
@@ -0,0 +1,52 @@
+#ifndef TRAJECTORY_WRITER_H
+#define TRAJECTORY_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "backgroundWriter.hpp"
+#include "checkpoint.hpp"
+#include "snapshotSink.hpp"
+
+// Writes the trajectories of all the cells to <prefix>trajectory.bin:
+//   "SWTRAJ1\n", the uint64 size of a JSON header (padded with spaces to a multiple of 8),
+//   the header (cells, chunk size, columns, compression), then chunks of chunk_size
+//   snapshots. A chunk is two uint64 (snapshots in the chunk, size of the payload) and a
+//   payload holding one column after the other: time[chunk_size], then x, y, direction
+//   (doubles) and tumbling (uint8) as [chunk_size][n_cells], zero padded to a multiple of
+//   8 bytes. Only the last chunk can be partly filled, so without compression every chunk
+//   has the same size and the file can be memory mapped (see plotter.py read_trajectory).
+// The chunks are compressed and written by a BackgroundWriter.
+class TrajectoryWriter: public SnapshotSink
+{
+    std::string file_name;
+    double time_step_size;
+    int step_size;
+    bool compress;
+    BackgroundWriter *writer;
+
+    int n_cells;
+    int chunk_size;    // snapshots per chunk
+    int n_buffered;    // snapshots in the current chunk
+    bool started;
+    int n_chunks;      // chunks handed to the writer
+    std::vector<double> time, x, y, direction;
+    std::vector<uint8_t> tumbling;
+
+  public:
+    TrajectoryWriter(nlohmann::json simulation_parameters, const std::string &prefix, BackgroundWriter *writer);
+    ~TrajectoryWriter();
+    SnapshotDemand get_demand() const override;
+    void save_snapshot(const SnapshotView &snapshot) override;
+    void flush();
+    void save_state(CheckpointWriter &out) const;
+    // also cuts the file after the chunks written before the checkpoint
+    void load_state(CheckpointReader &in);
+
+  protected:
+    void _start(int n_cells);
+    std::string _header() const;
+};
+
+#endif
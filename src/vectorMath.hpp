@@ -0,0 +1,88 @@
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+// Branch-free versions of sin/cos and log written only with arithmetic, selects and
+// bit operations, so that loops calling them are auto-vectorized (libm calls are not).
+// Accuracy is a few ulp, which is far below the noise of the simulation.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// compiles a function for AVX-512, AVX2 and a scalar fallback, the best version for the
+// running CPU is picked by the loader
+#define VECTOR_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+
+inline double _bits_to_double(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint64_t _double_to_bits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline void fast_sincos(double x, double *sin_x, double *cos_x)
+{
+    // reduction to [-pi/4, pi/4] with a three-part Cody-Waite pi/2
+    double q = std::floor(x * 0.63661977236758134308 + 0.5);
+    double r = x - q * 1.57079632673412561417e+00;
+    r -= q * 6.07710050630396597660e-11;
+    r -= q * 2.02226624871116645580e-21;
+    // beyond about 1e15 the reduction loses every digit, the bound keeps sin and cos in [-1, 1]
+    r = std::min(std::max(r, -0.8), 0.8);
+    double z = r * r;
+
+    double s = 1.58962301576546568060E-10;
+    s = s * z - 2.50507477628578072866E-8;
+    s = s * z + 2.75573136213857245213E-6;
+    s = s * z - 1.98412698295895385996E-4;
+    s = s * z + 8.33333333332211858878E-3;
+    s = s * z - 1.66666666666666307295E-1;
+    s = r + r * z * s;
+
+    double c = -1.13585365213876817300E-11;
+    c = c * z + 2.08757008419747316778E-9;
+    c = c * z - 2.75573141792967388112E-7;
+    c = c * z + 2.48015872888517045348E-5;
+    c = c * z - 1.38888888888730564116E-3;
+    c = c * z + 4.16666666666665929218E-2;
+    c = 1. - 0.5 * z + z * z * c;
+
+    // quadrant in {0, 1, 2, 3}
+    double quadrant = q - 4. * std::floor(q * 0.25);
+    double odd = quadrant - 2. * std::floor(quadrant * 0.5);
+    double sin_value = odd != 0. ? c : s;
+    double cos_value = odd != 0. ? s : c;
+    *sin_x = quadrant >= 2. ? -sin_value : sin_value;
+    *cos_x = quadrant == 1. ? -cos_value : (quadrant == 2. ? -cos_value : cos_value);
+}
+
+// natural logarithm of a positive, finite, normal number
+inline double fast_log(double x)
+{
+    uint64_t bits = _double_to_bits(x);
+    // biased exponent converted to double without an int64 -> double conversion
+    double exponent = _bits_to_double(0x4330000000000000ULL | (bits >> 52)) - 4503599627370496.0 - 1023.;
+    double m = _bits_to_double((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    bool high = m > 1.41421356237309504880;
+    m = high ? m * 0.5 : m;
+    exponent = high ? exponent + 1. : exponent;
+
+    double f = m - 1.;
+    double s = f / (2. + f);
+    double z = s * s;
+    double w = z * z;
+    double t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+    double t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+    double hfsq = 0.5 * f * f;
+    return exponent * 6.93147180369123816490e-01 - ((hfsq - (s * (hfsq + t1 + t2) + exponent * 1.90821492927058770002e-10)) - f);
+}
+
+#endif
@@ -72,7 +72,7 @@ void Visualization::render(Simulation *world, int start_time_step, int end_time_
 				this->camera.pixels[y][x][2] = 0;
 				this->camera.pixels[y][x][3] = 255;
 			}
-		world->draw_frame(time_step, &this->camera);
+		world->draw_frame(world->get_snapshot(time_step / step_size), &this->camera);
 		SDL_UpdateTexture(this->texture, NULL, &this->camera.pixels[0][0][0], SCREEN_WIDTH * 4);
 		SDL_RenderCopy(this->renderer, this->texture, NULL, &this->render_rectangle);
 
@@ -2,7 +2,7 @@
 #include <algorithm>
 #include <sstream>
 
-WallDisk::WallDisk(nlohmann::json physics_parameters, Map *map)
+WallDisk::WallDisk(nlohmann::json physics_parameters)
 {
     this->inner_radius = physics_parameters["innerRadius"].get<double>();
     this->outer_radius = this->inner_radius + physics_parameters["thickness"].get<double>();
@@ -10,13 +10,6 @@ WallDisk::WallDisk(nlohmann::json physics_parameters, Map *map)
     this->coord = {
         physics_parameters["x"].get<double>(),
         physics_parameters["y"].get<double>()};
-    if (physics_parameters["thickness"].get<double>() > 0)
-        for (double x = this->coord[0] - this->inner_radius + 0.5; x <= this->coord[0] + this->inner_radius - 0.5; x += 1.)
-        {
-            double y = sqrt(this->inner_radius * this->inner_radius - x * x);
-            map->arrive(this, Vector2D{x, -y});
-            map->arrive(this, Vector2D{x, y});
-        }
 }
 
 Vector2D WallDisk::get_coord() const
@@ -24,12 +17,12 @@ Vector2D WallDisk::get_coord() const
     return this->coord;
 }
 
-double WallDisk::get_inner_radius()
+double WallDisk::get_inner_radius() const
 {
     return this->inner_radius;
 }
 
-double WallDisk::get_hardness()
+double WallDisk::get_hardness() const
 {
     return this->hardness;
 }
@@ -60,63 +53,34 @@ void WallDisk::draw(int time_step, Camera *camera) const
         }
 }
 
-CellForce WallDisk::interaction(Cell *cell, int now)
+// distance of a point from the wall, negative outside the disk
+double WallDisk::signed_distance(Vector2D coord) const
 {
-    Vector2D wallCoord = this->coord;
-    CellInstance cellInstance = cell->get_instance(now);
+    return this->inner_radius - (coord - this->coord).modulus();
+}
 
-    Vector2D coord, flagella_e, body_e;
-    double distance;
-    double force_body_modulus;
-    double force_flagella_modulus;
+CellForce WallDisk::interaction(Vector2D body, Vector2D flagella, double body_radius, double flagella_radius) const
+{
+    Vector2D body_e, flagella_e;
+    double force_body_modulus = 0;
+    double force_flagella_modulus = 0;
 
-    // force on body
-    coord = cellInstance.coord - wallCoord;
-    distance = coord.modulus();
+    // force on body, towards the center
+    Vector2D coord = body - this->coord;
+    double distance = coord.modulus();
     if (distance > 0)
     {
         body_e = coord / (-distance);
-        distance = this->inner_radius - distance;
-
-        if (distance <= 0)
-            force_body_modulus = 10000.;
-        else if (distance < cell->get_body_radius() * 1.122462) // 2^(1/6)
-        {
-            double rad_6 = pow(cell->get_body_radius(), 6.);
-            double dist_6 = pow(distance, 6.);
-            force_body_modulus = 24 * this->hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
-        }
-        else
-            force_body_modulus = 0;
-    }
-    else
-    {
-        body_e = {0., 0.};
-        force_body_modulus = 0;
+        force_body_modulus = wall_force_modulus(this->inner_radius - distance, body_radius, this->hardness);
     }
 
-    // force on flagella
-    coord = cell->get_flagella_coord(cellInstance) - wallCoord;
+    // force on flagella, towards the center
+    coord = flagella - this->coord;
     distance = coord.modulus();
-    if (distance != 0)
+    if (distance > 0)
     {
         flagella_e = coord / (-distance);
-        distance = this->inner_radius - distance;
-        if (distance <= 0)
-            force_flagella_modulus = 10000.;
-        else if (distance < cell->get_flagella_radius() * 1.122462) // 2^(1/6)
-        {
-            double rad_6 = pow(cell->get_flagella_radius(), 6.);
-            double dist_6 = pow(distance, 6.);
-            force_flagella_modulus = 24 * this->hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
-        }
-        else
-            force_flagella_modulus = 0;
-    }
-    else
-    {
-        flagella_e = {0., 0.};
-        force_flagella_modulus = 0;
+        force_flagella_modulus = wall_force_modulus(this->inner_radius - distance, flagella_radius, this->hardness);
     }
     return CellForce(body_e * force_body_modulus, flagella_e * force_flagella_modulus);
-}
\ No newline at end of file
+}
@@ -3,11 +3,8 @@
 
 #include "nlohmann/json.hpp"
 #include "definition.hpp"
-#include "map.hpp"
-#include "actor.hpp"
-#include "cell.hpp"
 
-class WallDisk: public Actor
+class WallDisk
 {
     Vector2D coord;
     double inner_radius;
@@ -15,11 +12,12 @@ class WallDisk: public Actor
     double hardness;
 
   public:
-    WallDisk(nlohmann::json parameters, Map *map);
+    WallDisk(nlohmann::json parameters);
     Vector2D get_coord() const;
-    double get_inner_radius();
-    double get_hardness();
-    CellForce interaction(Cell* cell, int now) override;
+    double get_inner_radius() const;
+    double get_hardness() const;
+    double signed_distance(Vector2D coord) const;
+    CellForce interaction(Vector2D body, Vector2D flagella, double body_radius, double flagella_radius) const;
     std::string state_to_string(int time_step = -1) const;
     void draw(int time_step, Camera *camera) const;
 };
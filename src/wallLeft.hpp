@@ -3,20 +3,18 @@
 
 #include "nlohmann/json.hpp"
 #include "definition.hpp"
-#include "map.hpp"
-#include "actor.hpp"
-#include "cell.hpp"
 
-class WallLeft: public Actor
+class WallLeft
 {
     double x, x2;
     double hardness;
 
 public:
-    WallLeft(nlohmann::json parameters, Map *map);
+    WallLeft(nlohmann::json parameters);
     double get_x() const;
     double get_hardness() const;
-    CellForce interaction(Cell* cell, int now) override;
+    double signed_distance(Vector2D coord) const;
+    CellForce interaction(Vector2D body, Vector2D flagella, double body_radius, double flagella_radius) const;
     std::string state_to_string(int time_step = -1) const;
     void draw(int time_step, Camera *camera) const;
 };
@@ -2,13 +2,11 @@
 #include <algorithm>
 #include <sstream>
 
-WallRight::WallRight(nlohmann::json physics_parameters, Map *map)
+WallRight::WallRight(nlohmann::json physics_parameters)
 {
     this->x = physics_parameters["x"].get<double>();
     this->x2 = this->x + physics_parameters["thickness"].get<double>();
     this->hardness = physics_parameters["wallInteraction"]["hardness"].get<double>();
-    if (physics_parameters["thickness"].get<double>() > 0)
-        map->vertical(this, this->x);
 }
 
 double WallRight::get_x() const
@@ -43,40 +41,15 @@ void WallRight::draw(int time_step, Camera *camera) const
             }
 }
 
-CellForce WallRight::interaction(Cell *cell, int now)
+// distance of a point from the wall, negative on the other side
+double WallRight::signed_distance(Vector2D coord) const
 {
-    CellInstance cellInstance = cell->get_instance(now);
-
-    double distance;
-    double force_body_modulus;
-    double force_flagella_modulus;
-
-    // force on body
-    distance = this->x - cellInstance.coord[0];
-
-    if (distance <= 0)
-        force_body_modulus = 10000.;
-    else if (distance < cell->get_body_radius() * 1.122462) // 2^(1/6)
-    {
-        double rad_6 = pow(cell->get_body_radius(), 6.);
-        double dist_6 = pow(distance, 6.);
-        force_body_modulus = 24 * this->hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
-    }
-    else
-        force_body_modulus = 0;
-
-    // force on flagella
-    distance = this->x - cell->get_flagella_coord(cellInstance)[0];
-    if (distance <= 0)
-        force_flagella_modulus = 10000.;
-    else if (distance < cell->get_flagella_radius() * 1.122462) // 2^(1/6)
-    {
-        double rad_6 = pow(cell->get_flagella_radius(), 6.);
-        double dist_6 = pow(distance, 6.);
-        force_flagella_modulus = 24 * this->hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
-    }
-    else
-        force_flagella_modulus = 0;
+    return this->x - coord[0];
+}
 
+CellForce WallRight::interaction(Vector2D body, Vector2D flagella, double body_radius, double flagella_radius) const
+{
+    double force_body_modulus = wall_force_modulus(this->signed_distance(body), body_radius, this->hardness);
+    double force_flagella_modulus = wall_force_modulus(this->signed_distance(flagella), flagella_radius, this->hardness);
     return CellForce(Vector2D{-force_body_modulus, 0.}, Vector2D{-force_flagella_modulus, 0.});
-}
\ No newline at end of file
+}
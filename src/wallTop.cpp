@@ -2,13 +2,11 @@
 #include <algorithm>
 #include <sstream>
 
-WallTop::WallTop(nlohmann::json physics_parameters, Map *map)
+WallTop::WallTop(nlohmann::json physics_parameters)
 {
     this->y = physics_parameters["y"].get<double>();
     this->y2 = this->y - physics_parameters["thickness"].get<double>();
     this->hardness = physics_parameters["wallInteraction"]["hardness"].get<double>();
-    if (physics_parameters["thickness"].get<double>() > 0)
-        map->horizontal(this, this->y);
 }
 
 double WallTop::get_y() const
@@ -43,40 +41,15 @@ void WallTop::draw(int time_step, Camera *camera) const
             }
 }
 
-CellForce WallTop::interaction(Cell *cell, int now)
+// distance of a point from the wall, negative on the other side
+double WallTop::signed_distance(Vector2D coord) const
 {
-    CellInstance cellInstance = cell->get_instance(now);
-
-    double distance;
-    double force_body_modulus;
-    double force_flagella_modulus;
-
-    // force on body
-    distance = cellInstance.coord[1] - this->y;
-
-    if (distance <= 0)
-        force_body_modulus = 10000.;
-    else if (distance < cell->get_body_radius() * 1.122462) // 2^(1/6)
-    {
-        double rad_6 = pow(cell->get_body_radius(), 6.);
-        double dist_6 = pow(distance, 6.);
-        force_body_modulus = 24 * this->hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
-    }
-    else
-        force_body_modulus = 0;
-
-    // force on flagella
-    distance = cell->get_flagella_coord(cellInstance)[1] - this->y;
-    if (distance <= 0)
-        force_flagella_modulus = 10000.;
-    else if (distance < cell->get_flagella_radius() * 1.122462) // 2^(1/6)
-    {
-        double rad_6 = pow(cell->get_flagella_radius(), 6.);
-        double dist_6 = pow(distance, 6.);
-        force_flagella_modulus = 24 * this->hardness * (2 * rad_6 * rad_6 / (dist_6 * dist_6 * distance) - rad_6 / (dist_6 * distance));
-    }
-    else
-        force_flagella_modulus = 0;
+    return coord[1] - this->y;
+}
 
+CellForce WallTop::interaction(Vector2D body, Vector2D flagella, double body_radius, double flagella_radius) const
+{
+    double force_body_modulus = wall_force_modulus(this->signed_distance(body), body_radius, this->hardness);
+    double force_flagella_modulus = wall_force_modulus(this->signed_distance(flagella), flagella_radius, this->hardness);
     return CellForce(Vector2D{0., force_body_modulus}, Vector2D{0., force_flagella_modulus});
-}
\ No newline at end of file
+}